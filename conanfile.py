@@ -11,6 +11,8 @@ class CppAppConan(ConanFile):
 
     def requirements(self):
         self.requires("fmt/10.2.1")
+        self.requires("libcurl/8.6.0")
+        self.requires("openssl/[>=1.1 <4]") # libcrypto for the credential store
 
     def layout(self):
         basic_layout(self) # Changed to basic_layout
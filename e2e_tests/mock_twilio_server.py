@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""Local stand-in for the Twilio Messages API, used by the perf scenarios.
+
+POST .../Messages.json answers 201 with a queued message, GET answers 200 with
+a delivered message, and HEAD (connection pre-warming) answers 200. The server
+speaks HTTP/1.1 with keep-alive so the app's connection reuse is exercised.
+
+Usage: mock_twilio_server.py --port-file FILE [--delay-ms N]
+The chosen port is written to FILE once the server is listening.
+"""
+import argparse
+import itertools
+import json
+import os
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+_sids = itertools.count(1)
+_sids_lock = threading.Lock()
+
+
+def next_sid():
+    with _sids_lock:
+        return "SM%032x" % next(_sids)
+
+
+class MockTwilioHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    disable_nagle_algorithm = True  # Headers and body are separate writes; avoid the delayed-ACK stall
+    delay_s = 0.0
+
+    def _reply(self, code, payload):
+        body = json.dumps(payload).encode() if payload is not None else b""
+        self.send_response(code)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        if self.command != "HEAD":
+            self.wfile.write(body)
+
+    def do_POST(self):
+        self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        if self.delay_s:
+            time.sleep(self.delay_s)
+        self._reply(201, {"sid": next_sid(), "status": "queued", "error_code": None, "error_message": None})
+
+    def do_GET(self):
+        if self.delay_s:
+            time.sleep(self.delay_s)
+        sid = self.path.rsplit("/", 1)[-1].split(".", 1)[0]
+        self._reply(200, {"sid": sid, "status": "delivered", "error_code": None, "error_message": None})
+
+    def do_HEAD(self):
+        self._reply(200, None)
+
+    def log_message(self, format, *args):
+        pass  # Keep perf runs quiet
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port-file", required=True)
+    parser.add_argument("--delay-ms", type=float, default=0.0, help="artificial latency per API call")
+    args = parser.parse_args()
+
+    MockTwilioHandler.delay_s = args.delay_ms / 1000.0
+    server = ThreadingHTTPServer(("127.0.0.1", 0), MockTwilioHandler)
+    server.daemon_threads = True
+    with open(args.port_file + ".tmp", "w") as f:
+        f.write(str(server.server_address[1]))
+    # Rename so the runner never reads a half-written file
+    os.replace(args.port_file + ".tmp", args.port_file)
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
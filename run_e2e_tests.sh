@@ -1,166 +1,273 @@
 #!/bin/bash
 
-# Exit on error
-set -e
+# Runs the end-to-end scenarios in e2e_tests/ in parallel, then the perf
+# scenarios in e2e_tests/perf/ one at a time against a local mock API server.
+#
+# Every scenario runs in its own working directory under build/e2e_work/, so it
+# gets its own config.txt and .out/.err files and cannot interfere with the
+# others. The working directory mirrors the repository layout (the scenario is
+# copied to <workdir>/e2e_tests/), so paths the app prints match the
+# .expected.* files.
+#
+# PERF_BUDGET_SCALE=N (default 1) multiplies the perf time budgets and divides
+# the throughput budgets by N for slow or shared hosts; 0 reports perf numbers
+# without enforcing any budget.
+#
+# Usage: ./run_e2e_tests.sh [--rebuild] [-j JOBS] [--no-perf] [NAME_FILTER]
 
 APP_NAME="./build/sms_app"
 TEST_DIR="e2e_tests"
-# The C++ app writes config.txt to its CWD. If sms_app is in build/, CWD is build/
-CONFIG_FILE_IN_APP_CWD="config.txt" # Relative to app's CWD
-APP_CWD_PATH="build" # Path to the app's expected CWD from project root
-FULL_CONFIG_PATH_FOR_SCRIPT="$APP_CWD_PATH/$CONFIG_FILE_IN_APP_CWD"
-
-
-passed_tests=0
-failed_tests=0
-
-# Optional: Rebuild the application
-if [[ "$1" == "--rebuild" ]]; then
-    echo "Rebuilding application..."
-    # Assuming Makefile is in project root
-    make clean && make
-    shift # Remove --rebuild from arguments
+PERF_DIR="$TEST_DIR/perf"
+WORK_ROOT="build/e2e_work"
+MOCK_SERVER="$TEST_DIR/mock_twilio_server.py"
+JOBS=$(nproc 2>/dev/null || echo 2)
+RUN_PERF=true
+FILTER=""
+BUDGET_SCALE="${PERF_BUDGET_SCALE:-1}"
+if ! [[ "$BUDGET_SCALE" =~ ^[0-9]+$ ]]; then
+    echo "ERROR: PERF_BUDGET_SCALE must be a whole number (got '$BUDGET_SCALE')."
+    exit 1
 fi
 
+while [[ $# -gt 0 ]]; do
+    case "$1" in
+        --rebuild)
+            echo "Rebuilding application..."
+            make clean && make || exit 1
+            ;;
+        -j)
+            JOBS="$2"
+            shift
+            ;;
+        --no-perf)
+            RUN_PERF=false
+            ;;
+        -h|--help)
+            echo "Usage: $0 [--rebuild] [-j JOBS] [--no-perf] [NAME_FILTER]"
+            exit 0
+            ;;
+        *)
+            FILTER="$1"
+            ;;
+    esac
+    shift
+done
+
 if [ ! -f "$APP_NAME" ]; then
     echo "ERROR: Application $APP_NAME not found. Build it first (e.g., with 'make' or './run_e2e_tests.sh --rebuild')."
     exit 1
 fi
+APP_ABS_PATH="$(cd "$(dirname "$APP_NAME")" && pwd)/$(basename "$APP_NAME")"
 
-# Ensure the app's CWD exists if it's not project root, for config file placement
-if [ ! -d "$APP_CWD_PATH" ]; then
-    echo "ERROR: Application CWD $APP_CWD_PATH does not exist. Check build process."
-    exit 1
-fi
+now_ms() {
+    date +%s%3N
+}
 
-# Function to run a single test case
+# Runs one functional scenario in its own working directory and writes
+# "<PASS|FAIL> <wall ms>" to <workdir>/result.
 run_test_case() {
-    local scenario_file_base="$1"
-    local scenario_file_relpath="${scenario_file_base}.scenario" # Relative to TEST_DIR
-    local scenario_file_abs_path="$TEST_DIR/$scenario_file_relpath"
-
-    # Expected files are in TEST_DIR with the full base name
-    local expected_out_file="$TEST_DIR/${scenario_file_base}.expected.out"
-    local expected_err_file="$TEST_DIR/${scenario_file_base}.expected.err"
-
-    # Actual files will be moved from where the app creates them
-    # App creates them as <scenario_basename>.out/err in its CWD (which is TEST_DIR for this script's execution of app)
-    # For clarity, let's define where the app will write them if its CWD *was* TEST_DIR
-    # However, the C++ code currently derives output file paths based on the *scenario file path itself*,
-    # stripping the path and original extension, then adding .out/.err.
-    # So, if scenario is e2e_tests/sc01_first_run.scenario, output is e2e_tests/sc01_first_run.out
-    local app_generated_out_relpath="${scenario_file_base}.out"
-    local app_generated_err_relpath="${scenario_file_base}.err"
-    local app_generated_out_abs_path="$TEST_DIR/$app_generated_out_relpath"
-    local app_generated_err_abs_path="$TEST_DIR/$app_generated_err_relpath"
-
-    # These are the files we'll use for diffing, after moving app_generated_*
-    local actual_out_file_for_diff="$TEST_DIR/${scenario_file_base}.actual.out"
-    local actual_err_file_for_diff="$TEST_DIR/${scenario_file_base}.actual.err"
-
-    local specific_config_template="$TEST_DIR/${scenario_file_base}.config.txt"
-
-    echo "-----------------------------------------------------"
-    echo "RUNNING TEST: $scenario_file_base"
-    echo "Scenario File (abs): $scenario_file_abs_path"
-    echo "-----------------------------------------------------"
-
-    # Cleanup previous actual outputs and app's config.txt from its CWD
-    rm -f "$app_generated_out_abs_path" "$app_generated_err_abs_path" \
-          "$actual_out_file_for_diff" "$actual_err_file_for_diff" \
-          "$FULL_CONFIG_PATH_FOR_SCRIPT"
-
-    # Setup specific config.txt if provided for the test
-    # This config file is placed where the *application* expects to find it (its CWD)
-    if [ -f "$specific_config_template" ]; then
-        echo "Using specific config template: $specific_config_template"
-        echo "Copying to: $FULL_CONFIG_PATH_FOR_SCRIPT"
-        cp "$specific_config_template" "$FULL_CONFIG_PATH_FOR_SCRIPT"
-    fi
+    local name="$1"
+    local work="$WORK_ROOT/$name"
 
-    # Run the application in test mode.
-    # The application executable $APP_NAME is run from the project root.
-    # The scenario file path $scenario_file_abs_path is absolute or relative to project root.
-    # The C++ code will create .out/.err files based on g_scenario_filepath (e.g., e2e_tests/sc01.out)
-    "$APP_NAME" --test-mode "$scenario_file_abs_path" > /dev/null 2> /dev/null || true
-    # `|| true` because the app might exit with failure code, which is expected in some tests. Diff will catch issues.
-    # The C++ app's internal redirection is what matters. Script's redirection here is just to silence stdout/stderr of the test runner itself.
-
-    # Move the app-generated .out and .err files to .actual.out and .actual.err for diffing
-    # The C++ code creates output files like e2e_tests/sc01_first_run.out (with path)
-    mv "$app_generated_out_abs_path" "$actual_out_file_for_diff" 2>/dev/null || {
-        echo "WARN: App generated .out file ($app_generated_out_abs_path) not found as expected. Creating empty actual file."
-        touch "$actual_out_file_for_diff"
-    }
-    mv "$app_generated_err_abs_path" "$actual_err_file_for_diff" 2>/dev/null || {
-        echo "WARN: App generated .err file ($app_generated_err_abs_path) not found as expected. Creating empty actual file."
-        touch "$actual_err_file_for_diff"
-    }
-
-    # Compare actual output with expected output
-    local test_passed=true
-    echo "Comparing stdout ($actual_out_file_for_diff vs $expected_out_file)..."
-    if diff -u "$expected_out_file" "$actual_out_file_for_diff"; then
-        echo "STDOUT matches expected."
-    else
-        echo "STDOUT differs for $scenario_file_base."
-        test_passed=false
+    rm -rf "$work"
+    mkdir -p "$work/$TEST_DIR"
+    cp "$TEST_DIR/$name.scenario" "$work/$TEST_DIR/"
+    # A scenario-specific config template becomes the app's config.txt
+    if [ -f "$TEST_DIR/$name.config.txt" ]; then
+        cp "$TEST_DIR/$name.config.txt" "$work/config.txt"
     fi
 
-    echo "Comparing stderr ($actual_err_file_for_diff vs $expected_err_file)..."
-    if diff -u "$expected_err_file" "$actual_err_file_for_diff"; then
-        echo "STDERR matches expected."
-    else
-        echo "STDERR differs for $scenario_file_base."
-        test_passed=false
+    local started
+    started=$(now_ms)
+    # A non-zero exit is expected in some scenarios; the output diff decides.
+    (cd "$work" && "$APP_ABS_PATH" --test-mode "$TEST_DIR/$name.scenario" > /dev/null 2>&1)
+    local elapsed=$(( $(now_ms) - started ))
+
+    # Each stream with a .expected file must match exactly.
+    local status="PASS"
+    local stream
+    for stream in out err; do
+        local expected="$TEST_DIR/$name.expected.$stream"
+        local actual="$work/$TEST_DIR/$name.$stream"
+        [ -f "$expected" ] || continue
+        [ -f "$actual" ] || : > "$actual"
+        if ! diff -u "$expected" "$actual" > "$work/$stream.diff"; then
+            status="FAIL"
+        fi
+    done
+    echo "$status $elapsed" > "$work/result"
+}
+
+# Reads KEY=VALUE lines from a .perf file into PERF_* variables, with the
+# budgets adjusted by PERF_BUDGET_SCALE.
+load_perf_spec() {
+    PERF_ARGS="" PERF_MESSAGES=0 PERF_MOCK_DELAY_MS=0 PERF_EXPECT_EXIT=0
+    PERF_MAX_WALL_MS="" PERF_MIN_MESSAGES_PER_SEC="" PERF_MAX_P99_MS=""
+    local key value
+    while IFS='=' read -r key value; do
+        case "$key" in
+            ''|'#'*) continue ;;
+            ARGS) PERF_ARGS="$value" ;;
+            MESSAGES) PERF_MESSAGES="$value" ;;
+            MOCK_DELAY_MS) PERF_MOCK_DELAY_MS="$value" ;;
+            EXPECT_EXIT) PERF_EXPECT_EXIT="$value" ;;
+            MAX_WALL_MS) PERF_MAX_WALL_MS="$value" ;;
+            MIN_MESSAGES_PER_SEC) PERF_MIN_MESSAGES_PER_SEC="$value" ;;
+            MAX_P99_MS) PERF_MAX_P99_MS="$value" ;;
+            *) echo "WARNING: Unknown key '$key' in $1" ;;
+        esac
+    done < "$1"
+    if [ "$BUDGET_SCALE" -eq 0 ]; then
+        PERF_MAX_WALL_MS="" PERF_MIN_MESSAGES_PER_SEC="" PERF_MAX_P99_MS=""
+    elif [ "$BUDGET_SCALE" -gt 1 ]; then
+        [ -n "$PERF_MAX_WALL_MS" ] && PERF_MAX_WALL_MS=$((PERF_MAX_WALL_MS * BUDGET_SCALE))
+        [ -n "$PERF_MAX_P99_MS" ] && PERF_MAX_P99_MS=$((PERF_MAX_P99_MS * BUDGET_SCALE))
+        [ -n "$PERF_MIN_MESSAGES_PER_SEC" ] && PERF_MIN_MESSAGES_PER_SEC=$((PERF_MIN_MESSAGES_PER_SEC / BUDGET_SCALE))
     fi
+}
 
-    if $test_passed; then
-        echo "TEST $scenario_file_base: PASSED"
-        passed_tests=$((passed_tests + 1))
-        # Optional: remove actual files on pass
-        # rm "$actual_out_file_for_diff" "$actual_err_file_for_diff"
-    else
-        echo "TEST $scenario_file_base: FAILED"
-        failed_tests=$((failed_tests + 1))
-        echo "Actual stdout ($actual_out_file_for_diff) and stderr ($actual_err_file_for_diff) are kept for review."
+# Runs one perf scenario against a fresh mock server and checks its budgets.
+# Writes "<PASS|FAIL> <wall ms> <summary>" to <workdir>/result and the reasons
+# for any failure to <workdir>/budget.txt.
+run_perf_case() {
+    local name="$1"
+    local work="$WORK_ROOT/perf/$name"
+    load_perf_spec "$PERF_DIR/$name.perf"
+
+    rm -rf "$work"
+    mkdir -p "$work"
+    python3 "$MOCK_SERVER" --port-file "$work/port" --delay-ms "$PERF_MOCK_DELAY_MS" &
+    local server_pid=$!
+    local waited=0
+    while [ ! -f "$work/port" ] && [ "$waited" -lt 100 ]; do
+        sleep 0.05
+        waited=$((waited + 1))
+    done
+    if [ ! -f "$work/port" ]; then
+        kill "$server_pid" 2>/dev/null
+        echo "FAIL 0 mock server did not start" > "$work/result"
+        return
     fi
 
-    # Cleanup config.txt for next test, unless it's sc01 (which creates it for sc02)
-    # Scenarios that use a specific template will have $FULL_CONFIG_PATH_FOR_SCRIPT cleaned at the start of their run.
-    # sc01 is unique because it *creates* config.txt that sc02 *uses*.
-    if [[ "$scenario_file_base" != "sc01_first_run" && ! -f "$specific_config_template" ]]; then
-         rm -f "$FULL_CONFIG_PATH_FOR_SCRIPT"
-    elif [[ "$scenario_file_base" == "sc01_first_run" ]]; then
-        echo "INFO: Preserving config.txt created by sc01_first_run for sc02_load_config_send."
+    {
+        echo "ACCOUNT_SID=ACperf0000000000000000000000000000"
+        echo "AUTH_TOKEN=perf-token"
+        echo "FROM_NUMBER=+15005550006"
+        echo "API_BASE_URL=http://127.0.0.1:$(cat "$work/port")"
+        echo "RESULT_FORMAT=csv"
+        echo "RESULT_FILE=results.csv"
+        if [ -f "$PERF_DIR/$name.config.txt" ]; then cat "$PERF_DIR/$name.config.txt"; fi
+    } > "$work/config.txt"
+    awk -v n="$PERF_MESSAGES" 'BEGIN { for (i = 0; i < n; i++) printf "+1555%07d,Perf message %d\n", i, i }' > "$work/batch.txt"
+
+    local args
+    read -r -a args <<< "$PERF_ARGS"
+    local started
+    started=$(now_ms)
+    (cd "$work" && "$APP_ABS_PATH" "${args[@]}" > app.out 2> app.err)
+    local exit_code=$?
+    local elapsed=$(( $(now_ms) - started ))
+    kill "$server_pid" 2>/dev/null
+    wait "$server_pid" 2>/dev/null
+
+    local rate=0
+    if [ "$elapsed" -gt 0 ]; then rate=$(( PERF_MESSAGES * 1000 / elapsed )); fi
+    local summary="$rate msg/s"
+    local p99_us=""
+    if [ -f "$work/results.csv" ]; then
+        # total_us of accepted sends, nearest-rank p99
+        p99_us=$(awk -F, 'NR > 1 && $3 == 201 { print $11 }' "$work/results.csv" | sort -n |
+                 awk '{ v[NR] = $1 } END { if (NR > 0) { i = int((NR * 99 + 99) / 100); print v[i] } }')
+        if [ -n "$p99_us" ]; then summary="$summary, p99 $((p99_us / 1000)).$(( (p99_us % 1000) / 100 )) ms"; fi
     fi
 
+    : > "$work/budget.txt"
+    if [ "$exit_code" -ne "$PERF_EXPECT_EXIT" ]; then
+        echo "exit code $exit_code, expected $PERF_EXPECT_EXIT (see $work/app.err)" >> "$work/budget.txt"
+    fi
+    if [ -n "$PERF_MAX_WALL_MS" ] && [ "$elapsed" -gt "$PERF_MAX_WALL_MS" ]; then
+        echo "wall time ${elapsed} ms exceeds MAX_WALL_MS=$PERF_MAX_WALL_MS" >> "$work/budget.txt"
+    fi
+    if [ -n "$PERF_MIN_MESSAGES_PER_SEC" ] && [ "$rate" -lt "$PERF_MIN_MESSAGES_PER_SEC" ]; then
+        echo "throughput $rate msg/s below MIN_MESSAGES_PER_SEC=$PERF_MIN_MESSAGES_PER_SEC" >> "$work/budget.txt"
+    fi
+    if [ -n "$PERF_MAX_P99_MS" ]; then
+        if [ -z "$p99_us" ]; then
+            echo "no accepted sends in results.csv to measure p99 latency" >> "$work/budget.txt"
+        elif [ "$p99_us" -gt $((PERF_MAX_P99_MS * 1000)) ]; then
+            echo "p99 latency ${p99_us} us exceeds MAX_P99_MS=$PERF_MAX_P99_MS" >> "$work/budget.txt"
+        fi
+    fi
 
-    echo ""
+    if [ -s "$work/budget.txt" ]; then
+        echo "FAIL $elapsed $summary" > "$work/result"
+    else
+        echo "PASS $elapsed $summary" > "$work/result"
+    fi
 }
 
-# Define test cases to run (base names without .scenario extension, relative to $TEST_DIR)
-# Ensure sc01 runs first as sc02 depends on its config.txt output
-run_test_case "sc01_first_run"
-run_test_case "sc02_load_config_send"
-run_test_case "sc04_invalid_creds_api_fail"
-run_test_case "sc05a_invalid_recipient_format"
-run_test_case "sc06a_incomplete_config_file" # Needs e2e_tests/sc06a_incomplete_config_file.config.txt
-run_test_case "sc06b_malformed_config_file"   # Needs e2e_tests/sc06b_malformed_config_file.config.txt
+passed_tests=0
+failed_tests=0
+suite_started=$(now_ms)
+mkdir -p "$WORK_ROOT"
 
-# TODO: Add other test cases here once their .scenario and .expected files are created
-# run_test_case "sc03_load_decline_manual"
-# run_test_case "sc05b_invalid_recipient_api_fail"
+scenarios=()
+for scenario_path in "$TEST_DIR"/*.scenario; do
+    name=$(basename "$scenario_path" .scenario)
+    [[ -z "$FILTER" || "$name" == *"$FILTER"* ]] && scenarios+=("$name")
+done
 
+echo "Running ${#scenarios[@]} e2e scenario(s) with up to $JOBS in parallel..."
+for name in "${scenarios[@]}"; do
+    while [ "$(jobs -rp | wc -l)" -ge "$JOBS" ]; do
+        wait -n
+    done
+    run_test_case "$name" &
+done
+wait
+
+for name in "${scenarios[@]}"; do
+    read -r status elapsed < "$WORK_ROOT/$name/result"
+    printf "%-5s %-40s %6d ms\n" "$status" "$name" "$elapsed"
+    if [ "$status" = "PASS" ]; then
+        passed_tests=$((passed_tests + 1))
+    else
+        failed_tests=$((failed_tests + 1))
+        cat "$WORK_ROOT/$name"/*.diff
+        echo "Actual output kept in $WORK_ROOT/$name/$TEST_DIR/ for review."
+    fi
+done
+
+# Perf scenarios run one at a time so their timings are not skewed by each other.
+if $RUN_PERF && compgen -G "$PERF_DIR/*.perf" > /dev/null; then
+    if ! command -v python3 > /dev/null; then
+        echo "ERROR: python3 is required for the perf scenarios (or pass --no-perf)."
+        exit 1
+    fi
+    echo ""
+    echo "Running perf scenarios against the local mock server..."
+    for perf_path in "$PERF_DIR"/*.perf; do
+        name=$(basename "$perf_path" .perf)
+        [[ -z "$FILTER" || "$name" == *"$FILTER"* ]] || continue
+        run_perf_case "$name"
+        read -r status elapsed summary < "$WORK_ROOT/perf/$name/result"
+        printf "%-5s %-40s %6d ms  (%s)\n" "$status" "$name" "$elapsed" "$summary"
+        if [ "$status" = "PASS" ]; then
+            passed_tests=$((passed_tests + 1))
+        else
+            failed_tests=$((failed_tests + 1))
+            sed 's/^/      /' "$WORK_ROOT/perf/$name/budget.txt"
+        fi
+    done
+fi
 
 echo "-----------------------------------------------------"
 echo "E2E Test Summary:"
 echo "Passed: $passed_tests"
 echo "Failed: $failed_tests"
+echo "Wall time: $(( $(now_ms) - suite_started )) ms"
 echo "-----------------------------------------------------"
 
-# Do not cleanup temp_configs directory as it's not used by this version of the script
-
 if [ "$failed_tests" -ne 0 ]; then
     exit 1
 fi
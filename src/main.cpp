@@ -1,20 +1,37 @@
-
-#include <fmt/core.h>
-
-int main() {
-    fmt::print("Hello, world!\n");
-    return 0;
-=======
 #include <iostream>
 #include <string>
 #include <vector>
 #include <fstream> // For file I/O (ifstream, ofstream)
 #include <sstream> // For string stream operations (istringstream)
-#include <cstdio>      // For std::remove
+#include <cstdio>      // For std::remove, std::rename
 #include <curl/curl.h> // For libcurl functionalities
 #include <algorithm> // Required for std::find_if_not and transform for trim, and for std::all_of
 #include <cctype>    // Required for std::isdigit, std::isspace
 #include <cstdlib>   // Required for exit, EXIT_FAILURE
+#include <chrono>    // For steady_clock timestamps used by the circuit breaker and hedging
+#include <mutex>     // For guarding circuit breaker / latency tracker state
+#include <stdexcept> // For std::invalid_argument in setting parsing
+#include <iomanip>   // For std::setw in the transport benchmark table
+#include <memory>    // For std::unique_ptr in the message arena and pool
+#include <cstdint>   // For fixed-width keys and fingerprints
+#include <cstring>   // For memchr when scanning mapped batch files
+#include <unordered_set> // For suppression lists
+#include <thread>    // For the parallel dry-run workers and the result writer
+#include <condition_variable> // For waking the result writer thread
+#include <atomic>    // For the per-thread trace buffers
+#include <map>       // For grouping trace spans by stage
+#include <openssl/crypto.h> // OPENSSL_cleanse for wiping credential memory
+#include <openssl/evp.h>    // AES-256-GCM for the credential store
+#include <openssl/rand.h>   // Credential store nonces
+#include <sys/mman.h> // For mapping batch files in dry-run mode
+#include <sys/stat.h>
+#include <sys/socket.h> // SO_RCVBUF for transport profiles
+#include <netinet/in.h> // Loopback listener for the HTTP tests
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__SSE2__)
+#include <emmintrin.h> // SSE2 fast path in scan_message_body
+#endif
 // #include <string> // Already included via iostream or other headers indirectly but good for explicitness if it were standalone.
 
 // --- Mock SMS Behavior Control Enum ---
@@ -49,19 +66,923 @@ TestContext g_test_ctx; // Global instance of TestContext
 // Global constant for the configuration filename
 const std::string CONFIG_FILENAME = "config.txt";
 
+// --- Tracing ---
+// Opt-in profiling hooks. Setting SMS_TRACE_FILE=<path> in the environment
+// records a span for each hot-path stage: config loading, input reading,
+// body checks, URL encoding, each libcurl stage (from its CURLINFO_*_TIME_T
+// fields) and response handling. At exit the spans are written to <path> as
+// Chrome trace JSON (open in chrome://tracing or ui.perfetto.dev), and a
+// per-stage percentile table is printed. While tracing is off, each hook is a
+// single relaxed load of an atomic bool.
+
+// Time the process started; trace timestamps and startup latency are relative to it.
+const std::chrono::steady_clock::time_point g_process_start = std::chrono::steady_clock::now();
+
+int64_t microseconds_since_start() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - g_process_start).count();
+}
+
+struct TraceEvent {
+    const char* name;      // Stage name; always a string literal
+    int64_t start_us;      // Relative to g_process_start
+    int64_t duration_us;
+};
+
+// Events recorded by one thread. Only the owning thread appends, so recording
+// takes no lock. It writes the slot (allocating a new chunk when the previous
+// one is full) and then publishes it with a release store of `count`. The
+// exporter reads `count` with acquire. Chunks are allocated on demand up to
+// MAX_CHUNKS (about 4M events, roughly 800k batch messages); past that, events
+// are dropped, and the drop is reported on stderr, in the summary and in the
+// trace file.
+struct TraceBuffer {
+    static const size_t CHUNK_EVENTS = 1 << 16;
+    static const size_t MAX_CHUNKS = 64;
+    std::unique_ptr<TraceEvent[]> chunks[MAX_CHUNKS];
+    std::atomic<size_t> count;
+    std::atomic<size_t> dropped;
+    int thread_id;
+
+    explicit TraceBuffer(int id) : count(0), dropped(0), thread_id(id) {}
+
+    void append(const char* name, int64_t start_us, int64_t duration_us) {
+        size_t n = count.load(std::memory_order_relaxed);
+        size_t chunk = n / CHUNK_EVENTS;
+        if (chunk == MAX_CHUNKS) {
+            if (dropped.fetch_add(1, std::memory_order_relaxed) == 0) {
+                std::cerr << "WARNING: Trace buffer for thread " << thread_id << " is full (" << n
+                          << " events); later events from it are dropped." << std::endl;
+            }
+            return;
+        }
+        if (!chunks[chunk]) chunks[chunk].reset(new TraceEvent[CHUNK_EVENTS]);
+        TraceEvent& event = chunks[chunk][n % CHUNK_EVENTS];
+        event.name = name;
+        event.start_us = start_us;
+        event.duration_us = duration_us;
+        count.store(n + 1, std::memory_order_release);
+    }
+
+    // Only valid for i < a count loaded with acquire.
+    const TraceEvent& event(size_t i) const { return chunks[i / CHUNK_EVENTS][i % CHUNK_EVENTS]; }
+};
+
+class Tracer {
+public:
+    // Call before any worker thread starts.
+    void enable(const std::string& path) {
+        output_path = path;
+        enabled.store(true, std::memory_order_release);
+    }
+
+    bool is_enabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    void record(const char* name, int64_t start_us, int64_t duration_us) {
+        if (!is_enabled()) return;
+        static thread_local TraceBuffer* buffer = nullptr;
+        if (!buffer) buffer = register_thread(); // Once per thread; the only locked step
+        buffer->append(name, start_us, duration_us);
+    }
+
+    // Writes the Chrome trace file and prints the stage summary. Only the first
+    // call does anything. Threads still running may keep recording; events
+    // published before the export starts are included.
+    void finish() {
+        if (!enabled.exchange(false, std::memory_order_acq_rel)) return;
+        std::lock_guard<std::mutex> lock(registry_mtx);
+        write_chrome_trace();
+        print_summary();
+    }
+
+private:
+    TraceBuffer* register_thread() {
+        std::lock_guard<std::mutex> lock(registry_mtx);
+        buffers.push_back(std::unique_ptr<TraceBuffer>(new TraceBuffer(static_cast<int>(buffers.size()) + 1)));
+        return buffers.back().get();
+    }
+
+    void write_chrome_trace() {
+        std::ofstream out(output_path);
+        if (!out.is_open()) {
+            std::cerr << "ERROR: Unable to write trace file (" << output_path << ")." << std::endl;
+            return;
+        }
+        out << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_events\":" << dropped_events() << "},\"traceEvents\":[\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"sms_app\"}}";
+        for (const std::unique_ptr<TraceBuffer>& buffer : buffers) {
+            out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread_id
+                << ",\"args\":{\"name\":\"" << (buffer->thread_id == 1 ? "main" : "thread " + std::to_string(buffer->thread_id)) << "\"}}";
+            size_t count = buffer->count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; ++i) {
+                const TraceEvent& event = buffer->event(i);
+                const char* dot = std::strchr(event.name, '.');
+                std::string category = dot ? std::string(event.name, dot) : std::string(event.name);
+                out << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                    << buffer->thread_id << ",\"ts\":" << event.start_us << ",\"dur\":" << event.duration_us << "}";
+            }
+        }
+        out << "\n]}\n";
+        std::cout << "\nINFO: Trace written to " << output_path << " (open in chrome://tracing or ui.perfetto.dev)." << std::endl;
+    }
+
+    size_t dropped_events() const {
+        size_t dropped = 0;
+        for (const std::unique_ptr<TraceBuffer>& buffer : buffers) dropped += buffer->dropped.load(std::memory_order_relaxed);
+        return dropped;
+    }
+
+    void print_summary() {
+        std::map<std::string, std::vector<int64_t>> durations;
+        for (const std::unique_ptr<TraceBuffer>& buffer : buffers) {
+            size_t count = buffer->count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; ++i) durations[buffer->event(i).name].push_back(buffer->event(i).duration_us);
+        }
+        size_t dropped = dropped_events();
+        auto nearest_rank = [](const std::vector<int64_t>& sorted, double p) -> double {
+            size_t rank = static_cast<size_t>(p * static_cast<double>(sorted.size()) + 0.999999);
+            return static_cast<double>(sorted[std::max<size_t>(rank, 1) - 1]) / 1000.0;
+        };
+        std::cout << "\n--- Trace Summary (ms) ---" << std::endl;
+        std::cout << std::left << std::setw(22) << "Stage" << std::right << std::setw(8) << "Count"
+                  << std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "p99" << std::setw(10) << "Max" << std::endl;
+        std::cout << std::fixed << std::setprecision(3);
+        for (auto& entry : durations) {
+            std::vector<int64_t>& values = entry.second;
+            std::sort(values.begin(), values.end());
+            std::cout << std::left << std::setw(22) << entry.first << std::right << std::setw(8) << values.size()
+                      << std::setw(10) << nearest_rank(values, 0.50) << std::setw(10) << nearest_rank(values, 0.95)
+                      << std::setw(10) << nearest_rank(values, 0.99) << std::setw(10) << values.back() / 1000.0 << std::endl;
+        }
+        std::cout.unsetf(std::ios::floatfield);
+        if (dropped > 0) {
+            std::cerr << "WARNING: " << dropped << " trace events were dropped (per-thread buffer full); "
+                      << "the trace and the percentiles above cover only the start of the run." << std::endl;
+        }
+    }
+
+    std::atomic<bool> enabled{false};
+    std::string output_path;
+    std::mutex registry_mtx;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+};
+
+Tracer g_tracer;
+
+// Start timestamp for a span that does not match a C++ scope; 0 while tracing is off.
+int64_t trace_clock() {
+    return g_tracer.is_enabled() ? microseconds_since_start() : 0;
+}
+
+// Records a span from `start_us` (a trace_clock() value) until now.
+void trace_since(const char* name, int64_t start_us) {
+    if (g_tracer.is_enabled()) g_tracer.record(name, start_us, microseconds_since_start() - start_us);
+}
+
+// Records the enclosing scope as one span when tracing is enabled.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name) : name(name), start_us(trace_clock()) {}
+    ~TraceSpan() { trace_since(name, start_us); }
+
+private:
+    TraceSpan(const TraceSpan&);
+    TraceSpan& operator=(const TraceSpan&);
+    const char* name;
+    int64_t start_us;
+};
+
+// Enables tracing for the lifetime of main() if SMS_TRACE_FILE is set, and
+// exports the trace when main() returns. Paths that end the process with
+// exit() are covered by an atexit handler; whichever runs first exports.
+class TraceSession {
+public:
+    TraceSession() {
+        const char* path = std::getenv("SMS_TRACE_FILE");
+        if (path && *path) {
+            g_tracer.enable(path);
+            std::atexit(finish_at_exit);
+        }
+    }
+    ~TraceSession() { g_tracer.finish(); }
+
+private:
+    static void finish_at_exit() { g_tracer.finish(); }
+};
+
+// Connection-level tuning applied to every request, selected with TRANSPORT_PROFILE.
+// Fields left at 0/false keep libcurl's own default for that option.
+struct TransportProfile {
+    const char* name;
+    long http_version;          // CURLOPT_HTTP_VERSION
+    bool tcp_nodelay;           // Disable Nagle so small POSTs are not delayed waiting for ACKs
+    long tcp_keepalive_idle_s;  // Probe idle connections so reused ones are not silently dead
+    long receive_buffer_bytes;  // CURLOPT_BUFFERSIZE (libcurl receive buffer)
+    long socket_rcvbuf_bytes;   // SO_RCVBUF (kernel receive buffer), set before connect
+    bool accept_encoding;       // Advertise all compression encodings libcurl supports
+    bool pipewait;              // Prefer waiting for an HTTP/2 connection to multiplex over opening a new one
+};
+
+// Available transport profiles. "default" leaves libcurl's behavior unchanged.
+// "http2" and "compressed" negotiate HTTP/2 over TLS (ALPN) and fall back to
+// HTTP/1.1 on plain http:// URLs. "h2c" speaks HTTP/2 from the first byte
+// (prior knowledge), so it only works against servers that accept cleartext HTTP/2.
+const TransportProfile TRANSPORT_PROFILES[] = {
+    {"default",     CURL_HTTP_VERSION_NONE,              false, 0,  0,         0,          false, false},
+    {"low_latency", CURL_HTTP_VERSION_1_1,               true,  30, 0,         0,          false, false},
+    {"http2",       CURL_HTTP_VERSION_2TLS,              true,  30, 64 * 1024, 256 * 1024, false, true},
+    {"compressed",  CURL_HTTP_VERSION_2TLS,              true,  30, 64 * 1024, 256 * 1024, true,  true},
+    {"h2c",         CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE, true,  30, 64 * 1024, 256 * 1024, false, true},
+};
+
+// Looks up a transport profile by (case-insensitive) name. Returns nullptr if unknown.
+const TransportProfile* find_transport_profile(const std::string& name) {
+    std::string lowered = name;
+    std::transform(lowered.begin(), lowered.end(), lowered.begin(), ::tolower);
+    for (const TransportProfile& profile : TRANSPORT_PROFILES) {
+        if (lowered == profile.name) return &profile;
+    }
+    return nullptr;
+}
+
+// Timeouts, circuit breaker and hedging knobs for requests to the Twilio API.
+// All keys are optional in config.txt; the defaults below apply when a key is absent.
+struct TransportSettings {
+    long connect_timeout_ms = 5000;       // CONNECT_TIMEOUT_MS: TCP/TLS connect budget
+    long request_timeout_ms = 15000;      // REQUEST_TIMEOUT_MS: whole-transfer budget
+    long breaker_error_rate_pct = 50;     // BREAKER_ERROR_RATE: % of failures in the window that opens the breaker
+    long breaker_window = 20;             // BREAKER_WINDOW: number of recent outcomes considered
+    long breaker_min_requests = 10;       // BREAKER_MIN_REQUESTS: outcomes needed before the rate is trusted
+    long breaker_open_ms = 30000;         // BREAKER_OPEN_MS: how long to reject requests before probing
+    long breaker_half_open_probes = 1;    // BREAKER_HALF_OPEN_PROBES: successful probes needed to close again
+    bool hedge_status_queries = false;    // HEDGE_STATUS_QUERIES: send a backup status query after the p95 delay
+    long hedge_fallback_delay_ms = 500;   // HEDGE_FALLBACK_DELAY_MS: hedge delay until enough latency samples exist
+    std::string profile = "default";      // TRANSPORT_PROFILE: one of TRANSPORT_PROFILES
+    long prewarm_connections = 0;         // PREWARM_CONNECTIONS: connections to open to the API host at launch
+    long keepwarm_interval_ms = 0;        // KEEPWARM_INTERVAL_MS: re-touch pre-warmed connections this often (0: never)
+    std::string api_base_url = "https://api.twilio.com"; // API_BASE_URL: scheme and host of the API (tests use a local mock)
+};
+
+// Settings for --batch sends and --dry-run previews. Optional keys in config.txt.
+struct BatchSettings {
+    double cost_per_segment = 0.0079;  // COST_PER_SEGMENT: price of one SMS segment, used for dry-run estimates
+    std::string suppression_file;      // SUPPRESSION_FILE: numbers (one per line) that must never be messaged
+};
+
+// Local checks applied to message bodies before sending. Optional keys in config.txt.
+struct BodySettings {
+    long max_segments = 10;            // MAX_SEGMENTS: reject bodies needing more segments (0: no limit)
+    bool split_long_messages = false;  // SPLIT_LONG_MESSAGES: send multi-segment bodies as numbered parts
+};
+
+// Where credentials are kept when the encrypted store is used. Optional keys in config.txt.
+struct CredentialSettings {
+    std::string store_path = "credentials.enc"; // CREDENTIAL_STORE: encrypted store file
+    std::string account = "default";            // ACCOUNT: account to use from the store
+};
+
+// Where per-message send results are recorded. Optional keys in config.txt.
+struct ResultSinkSettings {
+    std::string format = "none";       // RESULT_FORMAT: none, csv, ndjson or columnar
+    std::string path;                  // RESULT_FILE: defaults to results.<format> (results.col for columnar)
+
+    std::string resolved_path() const {
+        if (!path.empty()) return path;
+        return (format == "columnar") ? "results.col" : "results." + format;
+    }
+};
+
+// Page-aligned memory for secrets: mlock'd so it is never swapped out,
+// excluded from core dumps, and zeroed before it is unmapped.
+class SecureBuffer {
+public:
+    explicit SecureBuffer(size_t size) : length(size) {
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        mapped = ((std::max<size_t>(size, 1) + page - 1) / page) * page;
+        void* memory = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) {
+            mapped = 0;
+            return;
+        }
+        bytes = static_cast<char*>(memory);
+        locked = (mlock(bytes, mapped) == 0);
+        if (!locked) {
+            static std::once_flag warned;
+            std::call_once(warned, []() {
+                std::cout << "WARNING: Unable to lock credential memory (RLIMIT_MEMLOCK); secrets may be swapped to disk." << std::endl;
+            });
+        }
+#ifdef MADV_DONTDUMP
+        madvise(bytes, mapped, MADV_DONTDUMP);
+#endif
+    }
+
+    ~SecureBuffer() {
+        if (!bytes) return;
+        OPENSSL_cleanse(bytes, mapped);
+        if (locked) munlock(bytes, mapped);
+        munmap(bytes, mapped);
+    }
+
+    bool valid() const { return bytes != nullptr; }
+    char* data() { return bytes; }
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    SecureBuffer(const SecureBuffer&);
+    SecureBuffer& operator=(const SecureBuffer&);
+    char* bytes = nullptr;
+    size_t length = 0;
+    size_t mapped = 0;
+    bool locked = false;
+};
+
+// A credential held in a SecureBuffer instead of on the heap. Copies share
+// one read-only buffer, and assigning a new value allocates a fresh one, so
+// a value never changes under a thread still using it. c_str() is only for
+// the places that hand the secret to curl, the store or config.txt.
+class SecretString {
+public:
+    SecretString() {}
+    explicit SecretString(const char* text) { assign(text); }
+
+    void assign(const char* text, size_t length) {
+        if (length == 0) {
+            clear();
+            return;
+        }
+        std::shared_ptr<SecureBuffer> copy = std::make_shared<SecureBuffer>(length + 1);
+        if (!copy->valid()) { // Left empty, so the credential is treated as missing
+            clear();
+            return;
+        }
+        std::memcpy(copy->data(), text, length);
+        copy->data()[length] = '\0';
+        buffer = copy;
+    }
+    void assign(const char* text) { assign(text, std::strlen(text)); }
+    void assign(const std::string& text) { assign(text.data(), text.size()); }
+    void clear() { buffer.reset(); }
+
+    bool empty() const { return size() == 0; }
+    size_t size() const { return buffer ? buffer->size() - 1 : 0; }
+    const char* c_str() const { return buffer ? buffer->data() : ""; }
+
+    bool equals(const char* text, size_t length) const {
+        return size() == length && CRYPTO_memcmp(c_str(), text, length) == 0;
+    }
+    bool operator==(const SecretString& other) const { return equals(other.c_str(), other.size()); }
+    bool operator!=(const SecretString& other) const { return !(*this == other); }
+    bool operator==(const char* text) const { return equals(text, std::strlen(text)); }
+    bool operator!=(const char* text) const { return !(*this == text); }
+
+private:
+    std::shared_ptr<const SecureBuffer> buffer;
+};
+
+// Zeroes a string's whole buffer (including spare capacity) and empties it,
+// for strings that held a secret.
+void wipe_string(std::string& secret) {
+    secret.resize(secret.capacity());
+    if (!secret.empty()) OPENSSL_cleanse(&secret[0], secret.size());
+    secret.clear();
+}
+
 // Structure to hold configuration data
 struct ConfigData {
-    std::string account_sid;
-    std::string auth_token;
+    SecretString account_sid;         // Kept in locked memory, like the store they may come from
+    SecretString auth_token;
     std::string from_number;
+    TransportSettings transport;      // Optional tuning keys; kept even when credentials are incomplete
+    BatchSettings batch;              // Optional batch keys; kept even when credentials are incomplete
+    ResultSinkSettings results;       // Optional result file keys; kept even when credentials are incomplete
+    BodySettings body;                // Optional body preflight keys; kept even when credentials are incomplete
+    CredentialSettings credentials;   // Encrypted store location and account name
     bool loaded_successfully = false; // Flag to indicate if loading was successful
 };
 
+// Parses a non-negative integer setting value.
+// Returns false (and leaves `out` untouched) if the value is not a valid number.
+bool parse_long_setting(const std::string& key, const std::string& value, long& out) {
+    try {
+        size_t consumed = 0;
+        long parsed = std::stol(value, &consumed);
+        if (consumed != value.length() || parsed < 0) {
+            throw std::invalid_argument("trailing characters or negative value");
+        }
+        out = parsed;
+        return true;
+    } catch (const std::exception& e) {
+        std::cout << "\nWARNING: Ignoring invalid value for " << key << ": '" << value << "'." << std::endl;
+        return false;
+    }
+}
+
+// Applies a single transport tuning key (already upper-cased) to `settings`.
+// Returns true if the key is a transport setting (even if its value was rejected).
+bool apply_transport_setting(const std::string& key, const std::string& value, TransportSettings& settings) {
+    if (key == "CONNECT_TIMEOUT_MS") { parse_long_setting(key, value, settings.connect_timeout_ms); return true; }
+    if (key == "REQUEST_TIMEOUT_MS") { parse_long_setting(key, value, settings.request_timeout_ms); return true; }
+    if (key == "BREAKER_ERROR_RATE") { parse_long_setting(key, value, settings.breaker_error_rate_pct); return true; }
+    if (key == "BREAKER_WINDOW") { parse_long_setting(key, value, settings.breaker_window); return true; }
+    if (key == "BREAKER_MIN_REQUESTS") { parse_long_setting(key, value, settings.breaker_min_requests); return true; }
+    if (key == "BREAKER_OPEN_MS") { parse_long_setting(key, value, settings.breaker_open_ms); return true; }
+    if (key == "BREAKER_HALF_OPEN_PROBES") { parse_long_setting(key, value, settings.breaker_half_open_probes); return true; }
+    if (key == "HEDGE_STATUS_QUERIES") {
+        settings.hedge_status_queries = (!value.empty() && (value[0] == 'y' || value[0] == 'Y'));
+        return true;
+    }
+    if (key == "HEDGE_FALLBACK_DELAY_MS") { parse_long_setting(key, value, settings.hedge_fallback_delay_ms); return true; }
+    if (key == "PREWARM_CONNECTIONS") { parse_long_setting(key, value, settings.prewarm_connections); return true; }
+    if (key == "KEEPWARM_INTERVAL_MS") { parse_long_setting(key, value, settings.keepwarm_interval_ms); return true; }
+    if (key == "TRANSPORT_PROFILE") {
+        const TransportProfile* profile = find_transport_profile(value);
+        if (profile) {
+            settings.profile = profile->name;
+        } else {
+            std::cout << "\nWARNING: Unknown TRANSPORT_PROFILE '" << value << "'; using '" << settings.profile << "'." << std::endl;
+        }
+        return true;
+    }
+    if (key == "API_BASE_URL") {
+        if (value.rfind("https://", 0) == 0 || value.rfind("http://", 0) == 0) {
+            settings.api_base_url = value;
+            while (settings.api_base_url.size() > 1 && settings.api_base_url.back() == '/') settings.api_base_url.pop_back();
+        } else {
+            std::cout << "\nWARNING: Ignoring API_BASE_URL '" << value << "'; it must start with http:// or https://." << std::endl;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Applies a single batch key (already upper-cased) to `settings`.
+// Returns true if the key is a batch setting (even if its value was rejected).
+bool apply_batch_setting(const std::string& key, const std::string& value, BatchSettings& settings) {
+    if (key == "COST_PER_SEGMENT") {
+        try {
+            size_t consumed = 0;
+            double parsed = std::stod(value, &consumed);
+            if (consumed != value.length() || parsed < 0.0) {
+                throw std::invalid_argument("trailing characters or negative value");
+            }
+            settings.cost_per_segment = parsed;
+        } catch (const std::exception& e) {
+            std::cout << "\nWARNING: Ignoring invalid value for " << key << ": '" << value << "'." << std::endl;
+        }
+        return true;
+    }
+    if (key == "SUPPRESSION_FILE") {
+        settings.suppression_file = value;
+        return true;
+    }
+    return false;
+}
+
+// Writes batch settings that differ from their defaults.
+void write_batch_settings(std::ostream& out, const BatchSettings& settings) {
+    const BatchSettings defaults;
+    if (settings.cost_per_segment != defaults.cost_per_segment) out << "COST_PER_SEGMENT=" << settings.cost_per_segment << std::endl;
+    if (!settings.suppression_file.empty()) out << "SUPPRESSION_FILE=" << settings.suppression_file << std::endl;
+}
+
+// Applies a single result sink key (already upper-cased) to `settings`.
+// Returns true if the key is a result sink setting (even if its value was rejected).
+bool apply_result_setting(const std::string& key, const std::string& value, ResultSinkSettings& settings) {
+    if (key == "RESULT_FORMAT") {
+        std::string format = value;
+        std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+        if (format == "none" || format == "csv" || format == "ndjson" || format == "columnar") {
+            settings.format = format;
+        } else {
+            std::cout << "\nWARNING: Unknown RESULT_FORMAT '" << value << "'; results will not be recorded." << std::endl;
+            settings.format = "none";
+        }
+        return true;
+    }
+    if (key == "RESULT_FILE") {
+        settings.path = value;
+        return true;
+    }
+    return false;
+}
+
+// Writes result sink settings that differ from their defaults.
+void write_result_settings(std::ostream& out, const ResultSinkSettings& settings) {
+    if (settings.format != "none") out << "RESULT_FORMAT=" << settings.format << std::endl;
+    if (!settings.path.empty()) out << "RESULT_FILE=" << settings.path << std::endl;
+}
+
+// Applies a single body preflight key (already upper-cased) to `settings`.
+// Returns true if the key is a body setting (even if its value was rejected).
+bool apply_body_setting(const std::string& key, const std::string& value, BodySettings& settings) {
+    if (key == "MAX_SEGMENTS") { parse_long_setting(key, value, settings.max_segments); return true; }
+    if (key == "SPLIT_LONG_MESSAGES") {
+        settings.split_long_messages = (!value.empty() && (value[0] == 'y' || value[0] == 'Y'));
+        return true;
+    }
+    return false;
+}
+
+// Writes body preflight settings that differ from their defaults.
+void write_body_settings(std::ostream& out, const BodySettings& settings) {
+    const BodySettings defaults;
+    if (settings.max_segments != defaults.max_segments) out << "MAX_SEGMENTS=" << settings.max_segments << std::endl;
+    if (settings.split_long_messages != defaults.split_long_messages) out << "SPLIT_LONG_MESSAGES=" << (settings.split_long_messages ? "Y" : "N") << std::endl;
+}
+
+// Applies a single credential store key (already upper-cased) to `settings`.
+// Returns true if the key is a credential store setting.
+bool apply_credential_setting(const std::string& key, const std::string& value, CredentialSettings& settings) {
+    if (key == "CREDENTIAL_STORE") {
+        if (!value.empty()) settings.store_path = value;
+        return true;
+    }
+    if (key == "ACCOUNT") {
+        if (!value.empty()) settings.account = value;
+        return true;
+    }
+    return false;
+}
+
+// Writes transport settings that differ from their defaults, so hand-tuned
+// values survive a save_config() round trip without cluttering the file.
+void write_transport_settings(std::ostream& out, const TransportSettings& settings) {
+    const TransportSettings defaults;
+    if (settings.connect_timeout_ms != defaults.connect_timeout_ms) out << "CONNECT_TIMEOUT_MS=" << settings.connect_timeout_ms << std::endl;
+    if (settings.request_timeout_ms != defaults.request_timeout_ms) out << "REQUEST_TIMEOUT_MS=" << settings.request_timeout_ms << std::endl;
+    if (settings.breaker_error_rate_pct != defaults.breaker_error_rate_pct) out << "BREAKER_ERROR_RATE=" << settings.breaker_error_rate_pct << std::endl;
+    if (settings.breaker_window != defaults.breaker_window) out << "BREAKER_WINDOW=" << settings.breaker_window << std::endl;
+    if (settings.breaker_min_requests != defaults.breaker_min_requests) out << "BREAKER_MIN_REQUESTS=" << settings.breaker_min_requests << std::endl;
+    if (settings.breaker_open_ms != defaults.breaker_open_ms) out << "BREAKER_OPEN_MS=" << settings.breaker_open_ms << std::endl;
+    if (settings.breaker_half_open_probes != defaults.breaker_half_open_probes) out << "BREAKER_HALF_OPEN_PROBES=" << settings.breaker_half_open_probes << std::endl;
+    if (settings.hedge_status_queries != defaults.hedge_status_queries) out << "HEDGE_STATUS_QUERIES=" << (settings.hedge_status_queries ? "Y" : "N") << std::endl;
+    if (settings.hedge_fallback_delay_ms != defaults.hedge_fallback_delay_ms) out << "HEDGE_FALLBACK_DELAY_MS=" << settings.hedge_fallback_delay_ms << std::endl;
+    if (settings.profile != defaults.profile) out << "TRANSPORT_PROFILE=" << settings.profile << std::endl;
+    if (settings.prewarm_connections != defaults.prewarm_connections) out << "PREWARM_CONNECTIONS=" << settings.prewarm_connections << std::endl;
+    if (settings.keepwarm_interval_ms != defaults.keepwarm_interval_ms) out << "KEEPWARM_INTERVAL_MS=" << settings.keepwarm_interval_ms << std::endl;
+    if (settings.api_base_url != defaults.api_base_url) out << "API_BASE_URL=" << settings.api_base_url << std::endl;
+}
+
+// --- Credential Store ---
+// Credentials can live in an encrypted store instead of plaintext config.txt.
+// The store file (CREDENTIAL_STORE, default credentials.enc) holds any number
+// of named accounts, encrypted with AES-256-GCM. The key is 64 hex characters
+// taken from SMS_CREDENTIAL_KEY, or from a keyfile (SMS_CREDENTIAL_KEYFILE,
+// default credential.key). config.txt then only names the account with
+// ACCOUNT=<name>.
+//
+// The store is decrypted once per process into page-locked memory that is
+// excluded from core dumps and wiped on release. Threads read it through an
+// immutable snapshot that is swapped atomically when the store is saved.
+
+const char CREDENTIAL_STORE_MAGIC[8] = {'S', 'M', 'S', 'C', 'R', 'E', 'D', '1'};
+const size_t CREDENTIAL_NONCE_BYTES = 12;
+const size_t CREDENTIAL_TAG_BYTES = 16;
+const size_t CREDENTIAL_KEY_BYTES = 32;
+
+// One account. The fields point into the snapshot's SecureBuffer, or into
+// caller-owned strings when passed to CredentialStore::save().
+struct AccountCredentials {
+    const char* name;
+    const char* account_sid;
+    const char* auth_token;
+    const char* from_number;
+};
+
+// Decrypted contents of a store. Immutable once published.
+struct CredentialSnapshot {
+    std::string path;
+    std::unique_ptr<SecureBuffer> plaintext;  // "name\tsid\ttoken\tfrom\n" lines, split in place
+    std::vector<AccountCredentials> accounts;
+
+    const AccountCredentials* find(const std::string& name) const {
+        for (const AccountCredentials& account : accounts) {
+            if (name == account.name) return &account;
+        }
+        return nullptr;
+    }
+};
+
+// Parses a key given as 64 hex characters into `key` (CREDENTIAL_KEY_BYTES).
+bool parse_credential_key(const char* hex, size_t length, SecureBuffer& key) {
+    if (length != CREDENTIAL_KEY_BYTES * 2 || !key.valid() || key.size() < CREDENTIAL_KEY_BYTES) return false;
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    for (size_t i = 0; i < CREDENTIAL_KEY_BYTES; ++i) {
+        int high = nibble(hex[2 * i]), low = nibble(hex[2 * i + 1]);
+        if (high < 0 || low < 0) return false;
+        key.data()[i] = static_cast<char>((high << 4) | low);
+    }
+    return true;
+}
+
+// Loads the store key from SMS_CREDENTIAL_KEY, or from the keyfile named by
+// SMS_CREDENTIAL_KEYFILE (default credential.key). Returns nullptr if neither
+// is present, or if the key is malformed (reported).
+std::unique_ptr<SecureBuffer> load_credential_key() {
+    std::unique_ptr<SecureBuffer> key(new SecureBuffer(CREDENTIAL_KEY_BYTES));
+    const char* from_env = std::getenv("SMS_CREDENTIAL_KEY");
+    if (from_env && *from_env) {
+        if (parse_credential_key(from_env, std::strlen(from_env), *key)) return key;
+        std::cerr << "ERROR: SMS_CREDENTIAL_KEY must be " << CREDENTIAL_KEY_BYTES * 2 << " hex characters." << std::endl;
+        return nullptr;
+    }
+    const char* keyfile_env = std::getenv("SMS_CREDENTIAL_KEYFILE");
+    const std::string keyfile = (keyfile_env && *keyfile_env) ? keyfile_env : "credential.key";
+    int fd = open(keyfile.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat key_stat;
+    if (fstat(fd, &key_stat) == 0 && (key_stat.st_mode & 077) != 0) {
+        std::cout << "WARNING: Keyfile " << keyfile << " is readable by other users; restrict it with chmod 600." << std::endl;
+    }
+    SecureBuffer text(CREDENTIAL_KEY_BYTES * 2 + 2);
+    ssize_t read_bytes = text.valid() ? read(fd, text.data(), text.size()) : -1;
+    close(fd);
+    size_t length = read_bytes > 0 ? static_cast<size_t>(read_bytes) : 0;
+    while (length > 0 && std::isspace(static_cast<unsigned char>(text.data()[length - 1]))) length--;
+    if (parse_credential_key(text.data(), length, *key)) return key;
+    std::cerr << "ERROR: Keyfile " << keyfile << " must contain " << CREDENTIAL_KEY_BYTES * 2
+              << " hex characters (e.g. from 'openssl rand -hex 32')." << std::endl;
+    return nullptr;
+}
+
+// Encrypts `plaintext` into the store file format: magic, nonce, ciphertext, tag.
+// The magic is authenticated as associated data.
+bool encrypt_credentials(const SecureBuffer& key, const char* plaintext, size_t length, std::vector<unsigned char>& out) {
+    const size_t header = sizeof(CREDENTIAL_STORE_MAGIC) + CREDENTIAL_NONCE_BYTES;
+    out.assign(CREDENTIAL_STORE_MAGIC, CREDENTIAL_STORE_MAGIC + sizeof(CREDENTIAL_STORE_MAGIC));
+    out.resize(header + length + CREDENTIAL_TAG_BYTES);
+    if (RAND_bytes(&out[sizeof(CREDENTIAL_STORE_MAGIC)], static_cast<int>(CREDENTIAL_NONCE_BYTES)) != 1) return false;
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) return false;
+    int written = 0, final_written = 0;
+    bool ok = EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) == 1 &&
+              EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, static_cast<int>(CREDENTIAL_NONCE_BYTES), nullptr) == 1 &&
+              EVP_EncryptInit_ex(ctx, nullptr, nullptr, reinterpret_cast<const unsigned char*>(key.data()),
+                                 &out[sizeof(CREDENTIAL_STORE_MAGIC)]) == 1 &&
+              EVP_EncryptUpdate(ctx, nullptr, &written, reinterpret_cast<const unsigned char*>(CREDENTIAL_STORE_MAGIC),
+                                static_cast<int>(sizeof(CREDENTIAL_STORE_MAGIC))) == 1 &&
+              EVP_EncryptUpdate(ctx, &out[header], &written, reinterpret_cast<const unsigned char*>(plaintext),
+                                static_cast<int>(length)) == 1 &&
+              EVP_EncryptFinal_ex(ctx, &out[header] + written, &final_written) == 1 &&
+              EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, static_cast<int>(CREDENTIAL_TAG_BYTES), &out[header + length]) == 1;
+    EVP_CIPHER_CTX_free(ctx);
+    return ok;
+}
+
+// Decrypts a store file's contents into a new SecureBuffer (NUL-terminated).
+// Returns nullptr if the file is malformed, the key is wrong or the file was modified.
+std::unique_ptr<SecureBuffer> decrypt_credentials(const SecureBuffer& key, const std::vector<unsigned char>& in) {
+    const size_t header = sizeof(CREDENTIAL_STORE_MAGIC) + CREDENTIAL_NONCE_BYTES;
+    if (in.size() < header + CREDENTIAL_TAG_BYTES ||
+        std::memcmp(in.data(), CREDENTIAL_STORE_MAGIC, sizeof(CREDENTIAL_STORE_MAGIC)) != 0) {
+        return nullptr;
+    }
+    const size_t length = in.size() - header - CREDENTIAL_TAG_BYTES;
+    std::unique_ptr<SecureBuffer> plaintext(new SecureBuffer(length + 1));
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (!ctx || !plaintext->valid()) {
+        EVP_CIPHER_CTX_free(ctx);
+        return nullptr;
+    }
+    unsigned char* out = reinterpret_cast<unsigned char*>(plaintext->data());
+    std::vector<unsigned char> tag(in.end() - CREDENTIAL_TAG_BYTES, in.end());
+    int written = 0, final_written = 0;
+    bool ok = EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr, nullptr, nullptr) == 1 &&
+              EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_IVLEN, static_cast<int>(CREDENTIAL_NONCE_BYTES), nullptr) == 1 &&
+              EVP_DecryptInit_ex(ctx, nullptr, nullptr, reinterpret_cast<const unsigned char*>(key.data()),
+                                 &in[sizeof(CREDENTIAL_STORE_MAGIC)]) == 1 &&
+              EVP_DecryptUpdate(ctx, nullptr, &written, in.data(), static_cast<int>(sizeof(CREDENTIAL_STORE_MAGIC))) == 1 &&
+              EVP_DecryptUpdate(ctx, out, &written, &in[header], static_cast<int>(length)) == 1 &&
+              EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, static_cast<int>(CREDENTIAL_TAG_BYTES), tag.data()) == 1 &&
+              EVP_DecryptFinal_ex(ctx, out + written, &final_written) == 1; // Fails if the tag does not match
+    EVP_CIPHER_CTX_free(ctx);
+    if (!ok) return nullptr;
+    plaintext->data()[length] = '\0';
+    return plaintext;
+}
+
+// Splits decrypted store contents in place into a snapshot. Malformed lines are skipped.
+std::shared_ptr<const CredentialSnapshot> parse_credential_snapshot(const std::string& path, std::unique_ptr<SecureBuffer> plaintext) {
+    std::shared_ptr<CredentialSnapshot> snapshot = std::make_shared<CredentialSnapshot>();
+    snapshot->path = path;
+    char* p = plaintext->data();
+    char* end = p + plaintext->size() - 1;
+    while (p < end) {
+        char* line_end = static_cast<char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!line_end) line_end = end;
+        *line_end = '\0';
+        char* fields[4] = {p, nullptr, nullptr, nullptr};
+        int found = 1;
+        for (char* c = p; c < line_end && found < 4; ++c) {
+            if (*c == '\t') {
+                *c = '\0';
+                fields[found++] = c + 1;
+            }
+        }
+        if (found == 4 && *fields[0] != '\0') {
+            AccountCredentials account = {fields[0], fields[1], fields[2], fields[3]};
+            snapshot->accounts.push_back(account);
+        }
+        p = line_end + 1;
+    }
+    snapshot->plaintext = std::move(plaintext);
+    return snapshot;
+}
+
+class CredentialStore {
+public:
+    // Decrypts the store at `path` and publishes it as the current snapshot.
+    // Returns false (reported) if the file cannot be read or decrypted.
+    bool load(const std::string& path, const SecureBuffer& key) {
+        std::lock_guard<std::mutex> lock(writer_mtx);
+        return load_locked(path, key);
+    }
+
+    // Like load(), but decrypts at most once per process: reuses the current
+    // snapshot if it came from `path`, and does not retry a store that failed.
+    bool ensure_loaded(const std::string& path, const SecureBuffer& key) {
+        std::lock_guard<std::mutex> lock(writer_mtx);
+        std::shared_ptr<const CredentialSnapshot> current_snapshot = snapshot();
+        if (current_snapshot && current_snapshot->path == path) return true;
+        if (path == failed_path) return false;
+        return load_locked(path, key);
+    }
+
+    // Current snapshot, or nullptr if nothing is loaded. Never blocks on writers.
+    std::shared_ptr<const CredentialSnapshot> snapshot() const {
+        return std::atomic_load(&current);
+    }
+
+    // Adds or replaces `updates` (matched by name) in the store at `path`,
+    // keeping its other accounts, then publishes the result. An existing
+    // store that cannot be decrypted is never overwritten.
+    bool save(const std::string& path, const SecureBuffer& key, const std::vector<AccountCredentials>& updates) {
+        std::lock_guard<std::mutex> lock(writer_mtx);
+        std::shared_ptr<const CredentialSnapshot> existing = snapshot();
+        if (!existing || existing->path != path) {
+            struct stat store_stat;
+            if (stat(path.c_str(), &store_stat) == 0) {
+                if (!load_locked(path, key)) return false;
+                existing = snapshot();
+            } else {
+                existing.reset();
+            }
+        }
+
+        std::vector<AccountCredentials> merged;
+        if (existing) {
+            for (const AccountCredentials& account : existing->accounts) {
+                bool replaced = false;
+                for (const AccountCredentials& update : updates) replaced = replaced || std::strcmp(update.name, account.name) == 0;
+                if (!replaced) merged.push_back(account);
+            }
+        }
+        size_t total = 0;
+        for (const AccountCredentials& update : updates) {
+            const char* fields[4] = {update.name, update.account_sid, update.auth_token, update.from_number};
+            for (const char* field : fields) {
+                if (std::strpbrk(field, "\t\n") != nullptr || (field == update.name && *field == '\0')) {
+                    std::cerr << "ERROR: Account '" << update.name << "' has an empty name or a field containing a tab or newline." << std::endl;
+                    return false;
+                }
+            }
+            merged.push_back(update);
+        }
+        for (const AccountCredentials& account : merged) {
+            total += std::strlen(account.name) + std::strlen(account.account_sid) + std::strlen(account.auth_token) +
+                     std::strlen(account.from_number) + 4;
+        }
+
+        std::unique_ptr<SecureBuffer> plaintext(new SecureBuffer(total + 1));
+        if (!plaintext->valid()) return false;
+        char* out = plaintext->data();
+        for (const AccountCredentials& account : merged) {
+            const char* fields[4] = {account.name, account.account_sid, account.auth_token, account.from_number};
+            for (int i = 0; i < 4; ++i) {
+                size_t field_length = std::strlen(fields[i]);
+                std::memcpy(out, fields[i], field_length);
+                out += field_length;
+                *out++ = (i < 3) ? '\t' : '\n';
+            }
+        }
+        plaintext->data()[total] = '\0';
+
+        std::vector<unsigned char> encrypted;
+        if (!encrypt_credentials(key, plaintext->data(), total, encrypted) || !write_store_file(path, encrypted)) {
+            std::cerr << "ERROR: Unable to write credential store (" << path << ")." << std::endl;
+            return false;
+        }
+        std::atomic_store(&current, parse_credential_snapshot(path, std::move(plaintext)));
+        return true;
+    }
+
+private:
+    bool load_locked(const std::string& path, const SecureBuffer& key) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) {
+            std::cerr << "ERROR: Unable to open credential store (" << path << ")." << std::endl;
+            return false;
+        }
+        std::vector<unsigned char> encrypted((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::unique_ptr<SecureBuffer> plaintext = decrypt_credentials(key, encrypted);
+        if (!plaintext) {
+            std::cerr << "ERROR: Unable to decrypt credential store (" << path << "): wrong key or corrupted file." << std::endl;
+            failed_path = path;
+            return false;
+        }
+        failed_path.clear();
+        std::atomic_store(&current, parse_credential_snapshot(path, std::move(plaintext)));
+        return true;
+    }
+
+    // Writes via a temporary file and rename so a crash never leaves a truncated store.
+    static bool write_store_file(const std::string& path, const std::vector<unsigned char>& data) {
+        const std::string temp_path = path + ".tmp";
+        int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0) return false;
+        bool ok = write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()) && fsync(fd) == 0;
+        ok = (close(fd) == 0) && ok;
+        if (!ok || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+            std::remove(temp_path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    std::shared_ptr<const CredentialSnapshot> current;
+    std::string failed_path; // Store that could not be decrypted; guarded by writer_mtx
+    std::mutex writer_mtx;   // Serializes load/save; readers only use snapshot()
+};
+
+CredentialStore g_credential_store;
+
+// Fills the credentials of `config` from account config.credentials.account
+// in the encrypted store. Returns false if there is no store or key, or the
+// account is missing (reported).
+bool load_stored_credentials(ConfigData& config) {
+    struct stat store_stat;
+    if (stat(config.credentials.store_path.c_str(), &store_stat) != 0) return false;
+    std::unique_ptr<SecureBuffer> key = load_credential_key();
+    if (!key) {
+        std::cout << "\nWARNING: Credential store " << config.credentials.store_path
+                  << " exists but no key was found; set SMS_CREDENTIAL_KEY or create credential.key." << std::endl;
+        return false;
+    }
+    if (!g_credential_store.ensure_loaded(config.credentials.store_path, *key)) return false;
+    std::shared_ptr<const CredentialSnapshot> snapshot = g_credential_store.snapshot();
+    const AccountCredentials* account = snapshot->find(config.credentials.account);
+    if (!account) {
+        std::cerr << "ERROR: Account '" << config.credentials.account << "' not found in credential store ("
+                  << config.credentials.store_path << ")." << std::endl;
+        return false;
+    }
+    config.account_sid.assign(account->account_sid);
+    config.auth_token.assign(account->auth_token);
+    config.from_number = account->from_number;
+    return true;
+}
+
+// Returns true if saving `data` would replace an account in the encrypted
+// store that holds different credentials. False when there is no key or
+// store (credentials would go to config.txt or a new store).
+bool stored_account_conflicts(const ConfigData& data) {
+    struct stat store_stat;
+    if (stat(data.credentials.store_path.c_str(), &store_stat) != 0) return false;
+    std::unique_ptr<SecureBuffer> key = load_credential_key();
+    if (!key || !g_credential_store.ensure_loaded(data.credentials.store_path, *key)) return false;
+    std::shared_ptr<const CredentialSnapshot> snapshot = g_credential_store.snapshot();
+    const AccountCredentials* account = snapshot->find(data.credentials.account);
+    return account && (data.account_sid != account->account_sid || data.auth_token != account->auth_token ||
+                       data.from_number != account->from_number);
+}
+
+// Function to remove leading and trailing whitespace
+// std::isspace handles space, tab, newline, vertical tab, form feed, carriage return
+std::string trim_whitespace(const std::string& str) {
+    // Find the first non-whitespace character
+    auto first_not_space = std::find_if_not(str.begin(), str.end(), [](unsigned char c){ return std::isspace(c); });
+    // If the string is all whitespace, return an empty string
+    if (first_not_space == str.end()) {
+        return "";
+    }
+    // Find the last non-whitespace character
+    auto last_not_space = std::find_if_not(str.rbegin(), str.rend(), [](unsigned char c){ return std::isspace(c); }).base();
+    // Construct the substring from the first non-whitespace to the last non-whitespace character
+    return std::string(first_not_space, last_not_space);
+}
+
 // Loads configuration from a file.
 // - filename: The name of the configuration file to load.
 // Returns a ConfigData struct. If loading fails or file not found,
 // loaded_successfully will be false.
 ConfigData load_config(const std::string& filename) {
+    TraceSpan span("config.load");
     ConfigData config;
     std::ifstream infile(filename);
 
@@ -91,19 +1012,31 @@ ConfigData load_config(const std::string& filename) {
             value = trim_whitespace(value);
 
             if (key == "ACCOUNT_SID") {
-                config.account_sid = value;
+                config.account_sid.assign(value);
                 if (!value.empty()) sid_found = true; // Mark as found only if value is not empty
             } else if (key == "AUTH_TOKEN") {
-                config.auth_token = value;
+                config.auth_token.assign(value);
                 if (!value.empty()) token_found = true; // Mark as found only if value is not empty
+                wipe_string(value); // Only the SecretString copy should outlive this line
+                wipe_string(line);
             } else if (key == "FROM_NUMBER") {
                 config.from_number = value;
                 if (!value.empty()) number_found = true; // Mark as found only if value is not empty
+            } else if (!apply_transport_setting(key, value, config.transport) &&
+                       !apply_batch_setting(key, value, config.batch) &&
+                       !apply_result_setting(key, value, config.results) &&
+                       !apply_body_setting(key, value, config.body)) {
+                apply_credential_setting(key, value, config.credentials);
             }
         }
     }
     infile.close();
 
+    // Without a plaintext AUTH_TOKEN, credentials come from the encrypted store if there is one.
+    if (!token_found && load_stored_credentials(config)) {
+        sid_found = token_found = number_found = true;
+    }
+
     // Check if all essential fields were found and have non-empty values
     if (sid_found && token_found && number_found &&
         !config.account_sid.empty() && !config.auth_token.empty() && !config.from_number.empty()) {
@@ -131,26 +1064,12 @@ ConfigData load_config(const std::string& filename) {
 
 // Helper function to mask the auth token for display
 // Shows first 3, last 3 chars, and asterisks in between.
-std::string mask_auth_token(const std::string& token) {
-    if (token.length() < 8) { // Arbitrary length, if too short, just mask all
-        return std::string(token.length(), '*');
+std::string mask_auth_token(const char* token) {
+    const size_t length = std::strlen(token);
+    if (length < 8) { // Arbitrary length, if too short, just mask all
+        return std::string(length, '*');
     }
-    return token.substr(0, 3) + "****" + token.substr(token.length() - 3);
-}
-
-// Function to remove leading and trailing whitespace
-// std::isspace handles space, tab, newline, vertical tab, form feed, carriage return
-std::string trim_whitespace(const std::string& str) {
-    // Find the first non-whitespace character
-    auto first_not_space = std::find_if_not(str.begin(), str.end(), [](unsigned char c){ return std::isspace(c); });
-    // If the string is all whitespace, return an empty string
-    if (first_not_space == str.end()) {
-        return "";
-    }
-    // Find the last non-whitespace character
-    auto last_not_space = std::find_if_not(str.rbegin(), str.rend(), [](unsigned char c){ return std::isspace(c); }).base();
-    // Construct the substring from the first non-whitespace to the last non-whitespace character
-    return std::string(first_not_space, last_not_space);
+    return std::string(token, 3) + "****" + std::string(token + length - 3, 3);
 }
 
 
@@ -159,24 +1078,63 @@ std::string trim_whitespace(const std::string& str) {
 // - data: The ConfigData struct containing the information to save.
 // Returns true if saving was successful, false otherwise.
 bool save_config(const std::string& filename, const ConfigData& data) {
-    std::ofstream outfile(filename); // Opens in truncation mode by default
+    // With a store key available, credentials go to the encrypted store and
+    // config.txt only names the account.
+    std::unique_ptr<SecureBuffer> key = load_credential_key();
+
+    // config.txt is written to a temporary file first and only renamed into
+    // place after the store is saved, so a failure at any step leaves both
+    // files as they were.
+    const std::string temp_filename = filename + ".tmp";
+    std::ofstream outfile(temp_filename); // Opens in truncation mode by default
     if (!outfile.is_open()) {
-        std::cerr << "ERROR: Unable to open configuration file (" << filename << ") for writing." << std::endl;
+        std::cerr << "ERROR: Unable to open configuration file (" << temp_filename << ") for writing." << std::endl;
         return false;
     }
 
-    outfile << "ACCOUNT_SID=" << data.account_sid << std::endl;
-    outfile << "AUTH_TOKEN=" << data.auth_token << std::endl;
-    outfile << "FROM_NUMBER=" << data.from_number << std::endl;
+    if (key) {
+        outfile << "ACCOUNT=" << data.credentials.account << std::endl;
+        if (data.credentials.store_path != CredentialSettings().store_path) {
+            outfile << "CREDENTIAL_STORE=" << data.credentials.store_path << std::endl;
+        }
+    } else {
+        outfile << "ACCOUNT_SID=" << data.account_sid.c_str() << std::endl;
+        outfile << "AUTH_TOKEN=" << data.auth_token.c_str() << std::endl;
+        outfile << "FROM_NUMBER=" << data.from_number << std::endl;
+    }
+    write_transport_settings(outfile, data.transport);
+    write_batch_settings(outfile, data.batch);
+    write_result_settings(outfile, data.results);
+    write_body_settings(outfile, data.body);
 
+    outfile.close();
     if (outfile.fail()) {
-        std::cerr << "ERROR: Failed to write all data to configuration file (" << filename << ")." << std::endl;
-        outfile.close();
+        std::cerr << "ERROR: Failed to write all data to configuration file (" << temp_filename << ")." << std::endl;
+        std::remove(temp_filename.c_str());
+        return false;
+    }
+
+    if (key) {
+        AccountCredentials account = {data.credentials.account.c_str(), data.account_sid.c_str(),
+                                      data.auth_token.c_str(), data.from_number.c_str()};
+        if (!g_credential_store.save(data.credentials.store_path, *key, std::vector<AccountCredentials>(1, account))) {
+            std::remove(temp_filename.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temp_filename.c_str(), filename.c_str()) != 0) {
+        std::cerr << "ERROR: Unable to replace configuration file (" << filename << ")." << std::endl;
+        std::remove(temp_filename.c_str());
         return false;
     }
 
-    outfile.close();
     std::cout << "\nINFO: Configuration saved successfully to " << filename << "." << std::endl;
+    if (key) {
+        std::cout << "INFO: Credentials for account '" << data.credentials.account << "' saved encrypted to "
+                  << data.credentials.store_path << "." << std::endl;
+    } else {
+        std::cout << "WARNING: AUTH_TOKEN is stored in plaintext. Set SMS_CREDENTIAL_KEY or create credential.key to encrypt it." << std::endl;
+    }
     return true;
 }
 
@@ -197,25 +1155,1250 @@ size_t WriteCallback(void *contents, size_t size, size_t nmemb, std::string *s)
         std::cerr << "CRITICAL: Memory allocation failed in WriteCallback." << std::endl;
         return 0; // Signal an error to libcurl
     }
-    return newLength; // Signal success to libcurl
+    return newLength; // Signal success to libcurl
+}
+
+// Helper function to URL-encode a string using libcurl
+// URL encoding ensures that data sent in URLs or POST bodies is correctly interpreted,
+// especially special characters.
+// - curl: A CURL easy handle (used by curl_easy_escape)
+// - value: The string to be URL-encoded
+// Returns the URL-encoded string. Returns an empty string on failure.
+std::string url_encode(CURL *curl, const std::string &value) {
+    // curl_easy_escape URL-encodes the given string.
+    // The returned string must be freed with curl_free.
+    char *output = curl_easy_escape(curl, value.c_str(), value.length());
+    if (output) {
+        std::string result(output);
+        curl_free(output); // Free the allocated memory
+        return result;
+    }
+    return ""; // Return empty string if encoding fails
+}
+
+// --- SMS Segment Counting ---
+// Messages that fit the GSM 03.38 alphabet are sent as 7-bit septets (160 per
+// single SMS, 153 per part when concatenated). Anything else is sent as UCS-2
+// (70 UTF-16 units per single SMS, 67 per part).
+
+// Returns the number of septets `code_point` takes in GSM-7 (1, or 2 for the
+// extension table), or 0 if it cannot be encoded in GSM-7.
+int gsm7_septets(uint32_t code_point) {
+    if (code_point < 0x80) {
+        switch (code_point) {
+            case '\n': case '\r': return 1;
+            case '^': case '{': case '}': case '\\': case '[': case ']': case '~': case '|': case '\f': return 2;
+            case '`': return 0;
+            default: return (code_point >= 0x20 && code_point < 0x7F) ? 1 : 0;
+        }
+    }
+    switch (code_point) {
+        case 0x00A3: case 0x00A5: case 0x00E8: case 0x00E9: case 0x00F9: case 0x00EC: case 0x00F2: case 0x00C7:
+        case 0x00D8: case 0x00F8: case 0x00C5: case 0x00E5: case 0x0394: case 0x03A6: case 0x0393: case 0x039B:
+        case 0x03A9: case 0x03A0: case 0x03A8: case 0x03A3: case 0x0398: case 0x039E: case 0x00C6: case 0x00E6:
+        case 0x00DF: case 0x00C9: case 0x00A4: case 0x00A1: case 0x00C4: case 0x00D6: case 0x00D1: case 0x00DC:
+        case 0x00A7: case 0x00BF: case 0x00E4: case 0x00F6: case 0x00F1: case 0x00FC: case 0x00E0:
+            return 1;
+        case 0x20AC: // Euro sign, extension table
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+// Decodes one UTF-8 sequence starting at `p`. Returns the number of bytes
+// consumed, or 0 if the sequence is invalid (overlong, surrogate, truncated).
+size_t decode_utf8(const unsigned char* p, const unsigned char* end, uint32_t& code_point) {
+    unsigned char lead = p[0];
+    size_t length;
+    uint32_t min_value;
+    if (lead < 0x80) { code_point = lead; return 1; }
+    else if ((lead & 0xE0) == 0xC0) { length = 2; code_point = lead & 0x1F; min_value = 0x80; }
+    else if ((lead & 0xF0) == 0xE0) { length = 3; code_point = lead & 0x0F; min_value = 0x800; }
+    else if ((lead & 0xF8) == 0xF0) { length = 4; code_point = lead & 0x07; min_value = 0x10000; }
+    else return 0;
+    if (static_cast<size_t>(end - p) < length) return 0;
+    for (size_t i = 1; i < length; ++i) {
+        if ((p[i] & 0xC0) != 0x80) return 0;
+        code_point = (code_point << 6) | (p[i] & 0x3F);
+    }
+    if (code_point < min_value || code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF)) return 0;
+    return length;
+}
+
+// How a message body will be encoded and how many SMS segments it needs.
+struct SegmentInfo {
+    bool gsm7 = true;
+    size_t units = 0;      // Septets for GSM-7, UTF-16 code units for UCS-2
+    size_t segments = 1;
+};
+
+// Counts the SMS segments needed for a UTF-8 body. Invalid bytes are counted
+// as one UCS-2 unit each (they would be replaced before sending).
+SegmentInfo count_sms_segments(const char* body, size_t length) {
+    SegmentInfo info;
+    size_t septets = 0, utf16_units = 0;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(body);
+    const unsigned char* end = p + length;
+    while (p < end) {
+        if (*p < 0x80) { // ASCII fast path: most bodies are plain ASCII
+            static const struct AsciiSeptets {
+                unsigned char table[128];
+                AsciiSeptets() { for (uint32_t c = 0; c < 128; ++c) table[c] = static_cast<unsigned char>(gsm7_septets(c)); }
+            } ascii;
+            unsigned char cost = ascii.table[*p++];
+            utf16_units++;
+            if (cost == 0) info.gsm7 = false;
+            septets += cost;
+            continue;
+        }
+        uint32_t code_point = 0;
+        size_t consumed = decode_utf8(p, end, code_point);
+        if (consumed == 0) {
+            info.gsm7 = false;
+            utf16_units++;
+            p++;
+            continue;
+        }
+        p += consumed;
+        utf16_units += (code_point >= 0x10000) ? 2 : 1;
+        if (info.gsm7) {
+            int cost = gsm7_septets(code_point);
+            if (cost == 0) info.gsm7 = false;
+            septets += static_cast<size_t>(cost);
+        }
+    }
+    info.units = info.gsm7 ? septets : utf16_units;
+    const size_t single_limit = info.gsm7 ? 160 : 70;
+    const size_t part_limit = info.gsm7 ? 153 : 67;
+    info.segments = (info.units <= single_limit) ? 1 : (info.units + part_limit - 1) / part_limit;
+    return info;
+}
+
+// Returns the ITU calling code (1-999) of a number given as its digits after '+'.
+// E.164 calling codes are prefix-free: 1 and 7 are the only one-digit codes and
+// the two-digit ones are listed below; every other code has three digits.
+int calling_code_of(const char* digits, size_t count) {
+    if (count == 0) return 0;
+    int first = digits[0] - '0';
+    if (first == 1 || first == 7) return first;
+    if (count < 2) return first;
+    int two = first * 10 + (digits[1] - '0');
+    switch (two) {
+        case 20: case 27: case 30: case 31: case 32: case 33: case 34: case 36: case 39:
+        case 40: case 41: case 43: case 44: case 45: case 46: case 47: case 48: case 49:
+        case 51: case 52: case 53: case 54: case 55: case 56: case 57: case 58:
+        case 60: case 61: case 62: case 63: case 64: case 65: case 66:
+        case 81: case 82: case 84: case 86: case 90: case 91: case 92: case 93: case 94: case 95: case 98:
+            return two;
+        default:
+            return count < 3 ? two : two * 10 + (digits[2] - '0');
+    }
+}
+
+// --- Message Body Preflight ---
+// Bodies are checked locally before sending. The check validates UTF-8,
+// removes control characters and enforces MAX_SEGMENTS. With
+// SPLIT_LONG_MESSAGES=Y a multi-segment body is instead sent as numbered
+// single-segment parts. Bad payloads are rejected without a network round trip.
+
+// Result of scanning a body for UTF-8 validity and control characters.
+struct Utf8Scan {
+    bool valid = true;
+    size_t error_offset = 0;   // Byte offset of the first invalid sequence when !valid
+    bool has_control = false;  // C0/C1 control characters or DEL present (including newlines)
+};
+
+// Scans a body in one pass. Runs of printable ASCII are checked 16 bytes at a
+// time with SSE2 (part of the x86-64 baseline, so no runtime dispatch is
+// needed). Multi-byte sequences and control characters drop to the scalar
+// decoder. Other architectures use the scalar path throughout.
+Utf8Scan scan_message_body(const char* data, size_t length) {
+    Utf8Scan scan;
+    const unsigned char* start = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* p = start;
+    const unsigned char* end = start + length;
+    while (p < end) {
+#if defined(__SSE2__)
+        const __m128i space = _mm_set1_epi8(0x20);
+        const __m128i del = _mm_set1_epi8(0x7F);
+        while (end - p >= 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            // As signed bytes, 0x80-0xFF are negative, so one compare catches both
+            // non-ASCII bytes and C0 controls; DEL needs its own compare.
+            __m128i special = _mm_or_si128(_mm_cmplt_epi8(chunk, space), _mm_cmpeq_epi8(chunk, del));
+            if (_mm_movemask_epi8(special) != 0) break;
+            p += 16;
+        }
+        if (p == end) break;
+#endif
+        if (*p < 0x80) {
+            if (*p < 0x20 || *p == 0x7F) scan.has_control = true;
+            p++;
+            continue;
+        }
+        uint32_t code_point = 0;
+        size_t consumed = decode_utf8(p, end, code_point);
+        if (consumed == 0) {
+            scan.valid = false;
+            scan.error_offset = static_cast<size_t>(p - start);
+            return scan;
+        }
+        if (code_point <= 0x9F) scan.has_control = true; // C1 controls U+0080-U+009F
+        p += consumed;
+    }
+    return scan;
+}
+
+// Removes control characters from a valid UTF-8 body in place. Newlines and
+// carriage returns are kept (both exist in GSM-7); tabs become spaces.
+// Returns the number of characters removed or replaced.
+size_t strip_control_characters(std::string& body) {
+    size_t changed = 0, out = 0;
+    for (size_t i = 0; i < body.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(body[i]);
+        if (c == '\t') {
+            body[out++] = ' ';
+            changed++;
+        } else if ((c < 0x20 && c != '\n' && c != '\r') || c == 0x7F) {
+            changed++;
+        } else if (c == 0xC2 && i + 1 < body.size() && static_cast<unsigned char>(body[i + 1]) <= 0x9F) {
+            i++; // Two-byte encoding of a C1 control
+            changed++;
+        } else {
+            body[out++] = body[i];
+        }
+    }
+    body.resize(out);
+    return changed;
+}
+
+// Splits a body into byte ranges whose encoded size fits `room` septets (GSM-7)
+// or UTF-16 units (UCS-2). Cuts happen at the last space or newline in a part
+// when there is one, otherwise mid-word.
+std::vector<std::pair<size_t, size_t>> split_on_word_boundaries(const std::string& body, bool gsm7, size_t room) {
+    std::vector<std::pair<size_t, size_t>> ranges;
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(body.data());
+    const unsigned char* end = p + body.size();
+    const size_t npos = std::string::npos;
+    // break_begin..break_at is the run of spaces at the last break opportunity.
+    size_t part_begin = 0, units = 0, break_begin = npos, break_at = npos, units_after_break = 0;
+    size_t i = 0;
+    while (i < body.size()) {
+        uint32_t code_point = 0;
+        size_t consumed = decode_utf8(p + i, end, code_point);
+        if (consumed == 0) { consumed = 1; code_point = 0xFFFD; }
+        size_t cost = gsm7 ? static_cast<size_t>(gsm7_septets(code_point)) : (code_point >= 0x10000 ? 2 : 1);
+        if (units + cost > room && i > part_begin) {
+            if (break_at != npos && break_begin > part_begin) {
+                ranges.push_back(std::make_pair(part_begin, break_begin));
+                part_begin = break_at + 1; // Drop the whole run of spaces
+                units = units_after_break;
+            } else {
+                ranges.push_back(std::make_pair(part_begin, i));
+                part_begin = i;
+                units = 0;
+            }
+            break_at = npos;
+            continue; // Re-measure the current character against the new part
+        }
+        if ((code_point == ' ' || code_point == '\n') && i == part_begin && !ranges.empty()) {
+            part_begin = ++i; // Spaces continuing a run across the break would lead the next part
+            continue;
+        }
+        if (code_point == ' ' || code_point == '\n') {
+            if (break_at == npos || break_at + 1 != i) break_begin = i;
+            break_at = i;
+            units_after_break = 0;
+        } else if (break_at != npos) {
+            units_after_break += cost;
+        }
+        units += cost;
+        i += consumed;
+    }
+    if (part_begin < body.size()) ranges.push_back(std::make_pair(part_begin, body.size()));
+    return ranges;
+}
+
+size_t decimal_digits(size_t value) {
+    size_t digits = 1;
+    while (value >= 10) { value /= 10; digits++; }
+    return digits;
+}
+
+// Plans numbered single-segment parts for `body`, reserving room for a
+// "(i/n) " prefix on each. Returns the byte ranges of the parts.
+std::vector<std::pair<size_t, size_t>> plan_numbered_parts(const std::string& body, bool gsm7) {
+    const size_t capacity = gsm7 ? 160 : 70;
+    size_t assumed_digits = 1;
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        size_t prefix_width = 2 * assumed_digits + 3; // "(", digits, "/", digits, ") "
+        ranges = split_on_word_boundaries(body, gsm7, capacity - prefix_width);
+        size_t needed_digits = decimal_digits(ranges.size());
+        if (needed_digits <= assumed_digits) break;
+        assumed_digits = needed_digits; // More parts than the prefix width allowed for; plan again
+    }
+    return ranges;
+}
+
+// Builds the numbered parts ("(1/3) ...") for `body` from plan_numbered_parts().
+std::vector<std::string> build_numbered_parts(const std::string& body, bool gsm7) {
+    std::vector<std::pair<size_t, size_t>> ranges = plan_numbered_parts(body, gsm7);
+    std::vector<std::string> parts;
+    parts.reserve(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        parts.push_back("(" + std::to_string(i + 1) + "/" + std::to_string(ranges.size()) + ") " +
+                        body.substr(ranges[i].first, ranges[i].second - ranges[i].first));
+    }
+    return parts;
+}
+
+enum BodyStatus { BODY_OK, BODY_INVALID_UTF8, BODY_TOO_LONG };
+
+// Outcome of preflight_message_body().
+struct BodyPreflight {
+    BodyStatus status = BODY_OK;
+    size_t error_offset = 0;   // For BODY_INVALID_UTF8
+    size_t stripped = 0;       // Control characters removed or replaced
+    size_t segments = 1;       // Segments the body uses (numbered parts when split)
+    bool split = false;        // Send as numbered parts via build_numbered_parts()
+    bool gsm7 = true;
+};
+
+// Fills in the segment count and split decision for an already sanitized body
+// and applies MAX_SEGMENTS.
+void check_body_segments(const char* body, size_t length, const BodySettings& settings, BodyPreflight& result) {
+    SegmentInfo info = count_sms_segments(body, length);
+    result.gsm7 = info.gsm7;
+    result.segments = info.segments;
+    if (info.segments > 1 && settings.split_long_messages) {
+        result.split = true;
+        result.segments = plan_numbered_parts(std::string(body, length), info.gsm7).size();
+    }
+    if (settings.max_segments > 0 && result.segments > static_cast<size_t>(settings.max_segments)) {
+        result.status = BODY_TOO_LONG;
+    }
+}
+
+// Validates and sanitizes `body` in place and checks it against MAX_SEGMENTS.
+BodyPreflight preflight_message_body(std::string& body, const BodySettings& settings) {
+    TraceSpan span("body.preflight");
+    BodyPreflight result;
+    Utf8Scan scan = scan_message_body(body.data(), body.size());
+    if (!scan.valid) {
+        result.status = BODY_INVALID_UTF8;
+        result.error_offset = scan.error_offset;
+        return result;
+    }
+    if (scan.has_control) result.stripped = strip_control_characters(body);
+    check_body_segments(body.data(), body.size(), settings, result);
+    return result;
+}
+
+// Describes a failed preflight for error messages.
+std::string describe_body_preflight(const BodyPreflight& preflight, const BodySettings& settings) {
+    if (preflight.status == BODY_INVALID_UTF8) {
+        return "message body is not valid UTF-8 (byte " + std::to_string(preflight.error_offset) + ")";
+    }
+    if (preflight.status == BODY_TOO_LONG) {
+        return "message body needs " + std::to_string(preflight.segments) + (preflight.split ? " parts" : " segments") +
+               "; the limit is MAX_SEGMENTS=" + std::to_string(settings.max_segments);
+    }
+    return "message body is valid";
+}
+
+// --- Result Sink ---
+// Per-message outcomes are written to a machine-readable file (RESULT_FORMAT /
+// RESULT_FILE) so analytics jobs do not have to scrape log lines. Results are
+// queued by the sending thread and written in batches by a background thread.
+
+// What happened to one message (or one numbered part of it). Stored as a
+// uint8 in the columnar format, so values must not be renumbered.
+enum ResultStatus : uint8_t { RESULT_SENT, RESULT_FAILED, RESULT_SKIPPED, RESULT_INVALID, RESULT_SUPPRESSED };
+
+const char* result_status_name(uint8_t status) {
+    static const char* const names[] = {"sent", "failed", "skipped", "invalid", "suppressed"};
+    return status < sizeof(names) / sizeof(names[0]) ? names[status] : "unknown";
+}
+
+// Outcome of one send, as written to the result file. Fixed-size with no heap
+// members, so queuing a result is a plain copy into the writer's reserved queue.
+struct SendResult {
+    char recipient[17] = {};   // E.164 number, NUL-terminated
+    char sid[40] = {};         // Message SID from the response, empty if none
+    int64_t timestamp_ms = 0;  // Completion time, Unix epoch milliseconds
+    int32_t http_code = 0;     // 0 if no HTTP response was received
+    int32_t error_code = 0;    // Twilio error code from the response body, 0 if none
+    int32_t curl_code = 0;     // CURLcode of the transfer, 0 on success
+    int64_t dns_us = 0;        // Stage durations in microseconds (see StageTimings)
+    int64_t connect_us = 0;
+    int64_t tls_us = 0;
+    int64_t server_us = 0;
+    int64_t transfer_us = 0;
+    int64_t total_us = 0;
+    uint8_t status = RESULT_SENT; // ResultStatus; rows that were never sent have no HTTP or timing data
+    uint16_t segments = 0;     // SMS segments the body needs
+};
+
+// Per-stage durations of one transfer, derived from libcurl's cumulative
+// CURLINFO_*_TIME_T values. Stages that did not happen (e.g. DNS and connect on
+// a reused connection) are 0.
+struct StageTimings {
+    int64_t dns_us = 0;        // Name resolution
+    int64_t connect_us = 0;    // TCP connect
+    int64_t tls_us = 0;        // TLS handshake
+    int64_t server_us = 0;     // Request sent until first response byte
+    int64_t transfer_us = 0;   // First response byte until done
+    int64_t total_us = 0;
+};
+
+StageTimings read_stage_timings(CURL *curl) {
+    curl_off_t name_lookup = 0, connect = 0, app_connect = 0, pre_transfer = 0, start_transfer = 0, total = 0;
+    curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &name_lookup);
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &app_connect);
+    curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &pre_transfer);
+    curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &start_transfer);
+    curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+    auto span = [](curl_off_t from, curl_off_t to) -> int64_t { return to > from ? static_cast<int64_t>(to - from) : 0; };
+    StageTimings timings;
+    timings.dns_us = static_cast<int64_t>(name_lookup);
+    timings.connect_us = span(name_lookup, connect);
+    timings.tls_us = app_connect > 0 ? span(connect, app_connect) : 0;
+    timings.server_us = span(pre_transfer, start_transfer);
+    timings.transfer_us = span(start_transfer, total);
+    timings.total_us = static_cast<int64_t>(total);
+    return timings;
+}
+
+// Records libcurl's breakdown of one transfer as spans inside the
+// "request.http" span that started at `request_start_us`. DNS, connect and TLS
+// only appear for transfers that opened a new connection.
+void trace_curl_stages(const StageTimings& timings, int64_t request_start_us) {
+    if (!g_tracer.is_enabled()) return;
+    int64_t at = request_start_us;
+    if (timings.dns_us > 0) g_tracer.record("curl.dns", at, timings.dns_us);
+    at += timings.dns_us;
+    if (timings.connect_us > 0) g_tracer.record("curl.connect", at, timings.connect_us);
+    at += timings.connect_us;
+    if (timings.tls_us > 0) g_tracer.record("curl.tls", at, timings.tls_us);
+    int64_t server_start = request_start_us + timings.total_us - timings.transfer_us - timings.server_us;
+    g_tracer.record("curl.server", server_start, timings.server_us);
+    g_tracer.record("curl.transfer", server_start + timings.server_us, timings.transfer_us);
+}
+
+// Returns the position just past the JSON string whose opening quote is at
+// `p`, honoring backslash escapes, or `end` if the string is unterminated.
+const char* skip_json_string(const char* p, const char* end) {
+    for (++p; p < end; ++p) {
+        if (*p == '\\') {
+            if (++p == end) break;
+        } else if (*p == '"') {
+            return p + 1;
+        }
+    }
+    return end;
+}
+
+// Returns the position just past the JSON value starting at `p` (string,
+// number, literal, or a nested object/array skipped as a whole).
+const char* skip_json_value(const char* p, const char* end) {
+    if (p < end && *p == '"') return skip_json_string(p, end);
+    int depth = 0;
+    while (p < end) {
+        char c = *p;
+        if (c == '"') {
+            p = skip_json_string(p, end);
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (depth == 0) return p;
+            if (--depth == 0) return p + 1;
+        } else if (depth == 0 && c == ',') {
+            return p;
+        }
+        p++;
+    }
+    return end;
+}
+
+// Finds `"key": value` among the top-level members of a JSON object; keys of
+// nested objects and text inside string values never match. On success points
+// `value` at the value text (string contents without quotes, escapes left as
+// written, or the raw number). Returns false if the key is absent or its value
+// is null.
+bool find_json_value(const char* json, size_t length, const std::string& key, const char*& value, size_t& value_length) {
+    const char* end = json + length;
+    auto skip_space = [end](const char* p) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+        return p;
+    };
+    const char* p = skip_space(json);
+    if (p == end || *p != '{') return false;
+    p = skip_space(p + 1);
+    while (p < end && *p == '"') {
+        const char* key_end = skip_json_string(p, end);
+        bool matches = static_cast<size_t>(key_end - p) == key.length() + 2 && std::equal(key.begin(), key.end(), p + 1);
+        p = skip_space(key_end);
+        if (p == end || *p != ':') return false;
+        p = skip_space(p + 1);
+        const char* value_end = skip_json_value(p, end);
+        if (matches) {
+            if (p < end && *p == '"') {
+                if (value_end == end && (value_end == p + 1 || value_end[-1] != '"')) return false;
+                value = p + 1;
+                value_length = static_cast<size_t>(value_end - 1 - value);
+                return true;
+            }
+            const char* stop = value_end;
+            while (stop > p && (stop[-1] == ' ' || stop[-1] == '\t' || stop[-1] == '\n' || stop[-1] == '\r')) stop--;
+            if (stop - p == 4 && std::equal(p, stop, "null")) return false;
+            value = p;
+            value_length = static_cast<size_t>(stop - p);
+            return value_length > 0;
+        }
+        p = skip_space(value_end);
+        if (p == end || *p != ',') return false;
+        p = skip_space(p + 1);
+    }
+    return false;
+}
+
+// Interface for result file formats. write() is only called from the writer thread.
+class ResultSink {
+public:
+    virtual ~ResultSink() {}
+    virtual void write(const std::vector<SendResult>& results) = 0;
+    virtual void flush() = 0;
+};
+
+// Shared file handling for the sinks: append mode, one write() per batch.
+class FileResultSink : public ResultSink {
+public:
+    explicit FileResultSink(const std::string& path) : path(path) {
+        std::ifstream existing(path, std::ios::binary | std::ios::ate);
+        is_new_file = !existing.is_open() || existing.tellg() <= 0;
+        out.open(path, std::ios::binary | std::ios::app);
+    }
+    bool is_open() const { return out.is_open(); }
+    void flush() override { out.flush(); }
+
+protected:
+    void emit(const std::string& data) {
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out) {
+            std::cerr << "ERROR: Failed to write results to " << path << "." << std::endl;
+            out.clear();
+        }
+    }
+    std::string path;
+    std::ofstream out;
+    bool is_new_file = true;
+    std::string buffer; // Reused formatting buffer
+};
+
+class CsvResultSink : public FileResultSink {
+public:
+    explicit CsvResultSink(const std::string& path) : FileResultSink(path) {
+        if (is_open() && is_new_file) {
+            emit("recipient,sid,http_code,error_code,curl_code,dns_us,connect_us,tls_us,server_us,transfer_us,total_us,status,segments,timestamp_ms\n");
+        }
+    }
+    void write(const std::vector<SendResult>& results) override {
+        buffer.clear();
+        for (const SendResult& r : results) {
+            buffer.append(r.recipient).push_back(',');
+            buffer.append(r.sid).push_back(',');
+            const int64_t numbers[] = {r.http_code, r.error_code, r.curl_code, r.dns_us, r.connect_us, r.tls_us,
+                                       r.server_us, r.transfer_us, r.total_us};
+            for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); ++i) {
+                buffer.append(std::to_string(static_cast<long long>(numbers[i]))).push_back(',');
+            }
+            buffer.append(result_status_name(r.status)).push_back(',');
+            buffer.append(std::to_string(r.segments)).push_back(',');
+            buffer.append(std::to_string(static_cast<long long>(r.timestamp_ms))).push_back('\n');
+        }
+        emit(buffer);
+    }
+};
+
+class NdjsonResultSink : public FileResultSink {
+public:
+    explicit NdjsonResultSink(const std::string& path) : FileResultSink(path) {}
+    void write(const std::vector<SendResult>& results) override {
+        buffer.clear();
+        for (const SendResult& r : results) {
+            // recipient and sid only ever contain [+0-9A-Za-z], so no escaping is needed.
+            buffer.append("{\"recipient\":\"").append(r.recipient);
+            buffer.append("\",\"sid\":\"").append(r.sid);
+            buffer.append("\",\"status\":\"").append(result_status_name(r.status)).append("\"");
+            const char* names[] = {"http_code", "error_code", "curl_code", "dns_us", "connect_us", "tls_us",
+                                   "server_us", "transfer_us", "total_us", "segments", "timestamp_ms"};
+            const int64_t numbers[] = {r.http_code, r.error_code, r.curl_code, r.dns_us, r.connect_us, r.tls_us,
+                                       r.server_us, r.transfer_us, r.total_us, r.segments, r.timestamp_ms};
+            for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); ++i) {
+                buffer.append(",\"").append(names[i]).append("\":");
+                buffer.append(std::to_string(static_cast<long long>(numbers[i])));
+            }
+            buffer.append("}\n");
+        }
+        emit(buffer);
+    }
+};
+
+// Binary columnar format: the file starts with the 8-byte magic "SMSRCOL2",
+// followed by blocks. Each block is a uint32 row count, then one contiguous
+// array per column in this order: int64 timestamp_ms; int32 http_code,
+// error_code, curl_code; int64 dns_us, connect_us, tls_us, server_us,
+// transfer_us, total_us; uint8 status (ResultStatus); uint16 segments; then the string columns
+// recipient and sid, each as uint32 end offsets followed by the concatenated
+// bytes. Integers use host byte order (little-endian on x86-64 and ARM64).
+class ColumnarResultSink : public FileResultSink {
+public:
+    explicit ColumnarResultSink(const std::string& path) : FileResultSink(path) {
+        if (is_open() && is_new_file) emit(std::string("SMSRCOL2", 8));
+    }
+    void write(const std::vector<SendResult>& results) override {
+        buffer.clear();
+        append_value(static_cast<uint32_t>(results.size()));
+        append_column(results, &SendResult::timestamp_ms);
+        append_column(results, &SendResult::http_code);
+        append_column(results, &SendResult::error_code);
+        append_column(results, &SendResult::curl_code);
+        append_column(results, &SendResult::dns_us);
+        append_column(results, &SendResult::connect_us);
+        append_column(results, &SendResult::tls_us);
+        append_column(results, &SendResult::server_us);
+        append_column(results, &SendResult::transfer_us);
+        append_column(results, &SendResult::total_us);
+        append_column(results, &SendResult::status);
+        append_column(results, &SendResult::segments);
+        append_string_column(results, &SendResult::recipient);
+        append_string_column(results, &SendResult::sid);
+        emit(buffer);
+    }
+
+private:
+    template <typename T>
+    void append_value(T value) {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    template <typename T>
+    void append_column(const std::vector<SendResult>& results, T SendResult::*field) {
+        for (const SendResult& r : results) append_value(r.*field);
+    }
+    template <size_t N>
+    void append_string_column(const std::vector<SendResult>& results, char (SendResult::*field)[N]) {
+        uint32_t offset = 0;
+        for (const SendResult& r : results) {
+            offset += static_cast<uint32_t>(strnlen(r.*field, N));
+            append_value(offset);
+        }
+        for (const SendResult& r : results) buffer.append(r.*field, strnlen(r.*field, N));
+    }
+};
+
+// Queues results from sending threads and writes them to a ResultSink from a
+// background thread, either every flush_rows results or every flush interval.
+class AsyncResultWriter {
+public:
+    AsyncResultWriter(std::unique_ptr<ResultSink> sink, size_t flush_rows, std::chrono::milliseconds flush_interval)
+        : sink(std::move(sink)), flush_rows(flush_rows), flush_interval(flush_interval) {
+        pending.reserve(flush_rows);
+        worker = std::thread(&AsyncResultWriter::run, this);
+    }
+
+    ~AsyncResultWriter() { close(); }
+
+    void submit(const SendResult& result) {
+        std::lock_guard<std::mutex> lock(mtx);
+        pending.push_back(result);
+        if (pending.size() >= flush_rows) wake.notify_one();
+    }
+
+    // Writes everything still queued and stops the background thread.
+    // Also called by the destructor, so every submitted result is written.
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (stopping) return;
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+private:
+    void run() {
+        std::vector<SendResult> batch;
+        batch.reserve(flush_rows);
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            wake.wait_for(lock, flush_interval, [this] { return stopping || pending.size() >= flush_rows; });
+            batch.swap(pending);
+            // Both buffers keep the largest capacity seen, so submit() only
+            // allocates when the queue grows past its previous peak.
+            if (pending.capacity() < batch.capacity()) pending.reserve(batch.capacity());
+            bool finished = stopping;
+            lock.unlock();
+            if (!batch.empty()) {
+                sink->write(batch);
+                batch.clear();
+            }
+            sink->flush();
+            lock.lock();
+            if (finished && pending.empty()) break;
+        }
+    }
+
+    std::unique_ptr<ResultSink> sink;
+    size_t flush_rows;
+    std::chrono::milliseconds flush_interval;
+    std::mutex mtx;
+    std::condition_variable wake;
+    std::vector<SendResult> pending;
+    bool stopping = false;
+    std::thread worker;
+};
+
+// Active result writer, or null when RESULT_FORMAT is "none".
+std::unique_ptr<AsyncResultWriter> g_result_writer;
+
+// Opens g_result_writer for the lifetime of a command and drains it on exit.
+class ResultWriterScope {
+public:
+    explicit ResultWriterScope(const ResultSinkSettings& settings) {
+        const std::string path = settings.resolved_path();
+        std::unique_ptr<FileResultSink> sink;
+        if (settings.format == "csv") sink.reset(new CsvResultSink(path));
+        else if (settings.format == "ndjson") sink.reset(new NdjsonResultSink(path));
+        else if (settings.format == "columnar") sink.reset(new ColumnarResultSink(path));
+        if (!sink) return;
+        if (!sink->is_open()) {
+            std::cerr << "ERROR: Unable to open result file (" << path << "); results will not be recorded." << std::endl;
+            return;
+        }
+        g_result_writer.reset(new AsyncResultWriter(std::unique_ptr<ResultSink>(sink.release()), 4096, std::chrono::milliseconds(1000)));
+    }
+    ~ResultWriterScope() { g_result_writer.reset(); }
+};
+
+// Starts a result row for `recipient`. Only [+0-9A-Za-z] is kept, so the text
+// of a malformed batch line cannot break the CSV or NDJSON output.
+SendResult make_send_result(const char* recipient, size_t recipient_length, ResultStatus status, size_t segments) {
+    SendResult result;
+    size_t used = 0;
+    for (size_t i = 0; i < recipient_length && used < sizeof(result.recipient) - 1; ++i) {
+        if (recipient[i] == '+' || std::isalnum(static_cast<unsigned char>(recipient[i]))) result.recipient[used++] = recipient[i];
+    }
+    result.status = status;
+    result.segments = static_cast<uint16_t>(std::min<size_t>(segments, 0xFFFF));
+    result.timestamp_ms = static_cast<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    return result;
+}
+
+// Queues a row for a message that was never sent (skipped, invalid or suppressed).
+void record_unsent_result(const char* recipient, size_t recipient_length, ResultStatus status, size_t segments) {
+    if (!g_result_writer) return;
+    g_result_writer->submit(make_send_result(recipient, recipient_length, status, segments));
+}
+
+// Queues the outcome of one send for the result file, if one is configured.
+// - response: The API response body, used to extract the SID and error code.
+// Copies the "sid" of an API response into `out` (`capacity` bytes including the
+// NUL), keeping only alphanumerics. Leaves `out` empty if there is no SID.
+void copy_response_sid(const char* response, size_t response_length, char* out, size_t capacity) {
+    const char* value = nullptr;
+    size_t value_length = 0;
+    size_t used = 0;
+    if (find_json_value(response, response_length, "sid", value, value_length)) {
+        for (size_t i = 0; i < value_length && used < capacity - 1; ++i) {
+            if (std::isalnum(static_cast<unsigned char>(value[i]))) out[used++] = value[i];
+        }
+    }
+    out[used] = '\0';
+}
+
+void record_send_result(const char* recipient, size_t recipient_length, const char* response, size_t response_length,
+                        long http_code, CURLcode curl_code, const StageTimings& timings, size_t segments) {
+    if (!g_result_writer) return;
+    bool accepted = curl_code == CURLE_OK && http_code >= 200 && http_code < 300;
+    SendResult result = make_send_result(recipient, recipient_length, accepted ? RESULT_SENT : RESULT_FAILED, segments);
+    copy_response_sid(response, response_length, result.sid, sizeof(result.sid));
+    const char* value = nullptr;
+    size_t value_length = 0;
+    if (find_json_value(response, response_length, "error_code", value, value_length) ||
+        find_json_value(response, response_length, "code", value, value_length)) {
+        result.error_code = static_cast<int32_t>(std::strtol(std::string(value, value_length).c_str(), nullptr, 10));
+    }
+    result.http_code = static_cast<int32_t>(http_code);
+    result.curl_code = static_cast<int32_t>(curl_code);
+    result.dns_us = timings.dns_us;
+    result.connect_us = timings.connect_us;
+    result.tls_us = timings.tls_us;
+    result.server_us = timings.server_us;
+    result.transfer_us = timings.transfer_us;
+    result.total_us = timings.total_us;
+    g_result_writer->submit(result);
+}
+
+// --- Circuit Breaker ---
+// Tracks the outcome of recent Twilio requests and stops sending while the API is
+// failing, so callers fail fast instead of each waiting out a full timeout.
+// - CLOSED: requests flow normally; outcomes are kept in a sliding window.
+// - OPEN: requests are rejected until breaker_open_ms has elapsed.
+// - HALF_OPEN: one probe request at a time is let through; enough successful
+//   probes close the breaker again, any failure re-opens it.
+// A BREAKER_ERROR_RATE of 0 disables the breaker.
+class CircuitBreaker {
+public:
+    enum State { CLOSED, OPEN, HALF_OPEN };
+
+    void configure(const TransportSettings& settings) {
+        std::lock_guard<std::mutex> lock(mtx);
+        error_rate_pct = settings.breaker_error_rate_pct;
+        window_size = settings.breaker_window > 0 ? static_cast<size_t>(settings.breaker_window) : 1;
+        min_requests = static_cast<size_t>(settings.breaker_min_requests);
+        open_duration = std::chrono::milliseconds(settings.breaker_open_ms);
+        probes_required = settings.breaker_half_open_probes > 0 ? settings.breaker_half_open_probes : 1;
+        state = CLOSED;
+        reset_window();
+    }
+
+    // Returns true if a request may be sent now. Callers that get true must
+    // report the outcome through record_success() or record_failure().
+    // `now` is only passed explicitly by tests.
+    bool allow_request(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (error_rate_pct <= 0) return true;
+        if (state == OPEN) {
+            if (now - opened_at < open_duration) return false;
+            state = HALF_OPEN;
+            probe_in_flight = false;
+            probe_successes = 0;
+        }
+        if (state == HALF_OPEN) {
+            if (probe_in_flight) return false;
+            probe_in_flight = true;
+        }
+        return true;
+    }
+
+    void record_success() {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (state == HALF_OPEN) {
+            probe_in_flight = false;
+            if (++probe_successes >= probes_required) {
+                state = CLOSED;
+                reset_window();
+            }
+            return;
+        }
+        if (state == CLOSED) push_outcome(false);
+    }
+
+    void record_failure(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (error_rate_pct <= 0) return;
+        if (state == HALF_OPEN) {
+            trip(now);
+            return;
+        }
+        if (state != CLOSED) return; // Late result from a request sent before the breaker opened
+        push_outcome(true);
+        if (filled >= min_requests && failures * 100 >= static_cast<size_t>(error_rate_pct) * filled) {
+            trip(now);
+        }
+    }
+
+    State current_state() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return state;
+    }
+
+private:
+    void reset_window() {
+        outcomes.assign(window_size, false);
+        next_slot = 0;
+        filled = 0;
+        failures = 0;
+    }
+
+    void push_outcome(bool failed) {
+        if (filled == window_size) {
+            if (outcomes[next_slot]) failures--; // Oldest outcome falls out of the window
+        } else {
+            filled++;
+        }
+        outcomes[next_slot] = failed;
+        if (failed) failures++;
+        next_slot = (next_slot + 1) % window_size;
+    }
+
+    void trip(std::chrono::steady_clock::time_point now) {
+        state = OPEN;
+        opened_at = now;
+        probe_in_flight = false;
+        reset_window();
+    }
+
+    mutable std::mutex mtx;
+    State state = CLOSED;
+    long error_rate_pct = 50;
+    size_t window_size = 20;
+    size_t min_requests = 10;
+    long probes_required = 1;
+    std::chrono::milliseconds open_duration{30000};
+    std::chrono::steady_clock::time_point opened_at;
+    std::vector<bool> outcomes = std::vector<bool>(20, false);
+    size_t next_slot = 0;
+    size_t filled = 0;
+    size_t failures = 0;
+    bool probe_in_flight = false;
+    long probe_successes = 0;
+};
+
+// Keeps the most recent request latencies so hedging can be triggered at the
+// observed p95 instead of a fixed guess.
+class LatencyTracker {
+public:
+    explicit LatencyTracker(size_t capacity = 256) : samples(capacity, 0) {}
+
+    void record(long latency_ms) {
+        std::lock_guard<std::mutex> lock(mtx);
+        samples[next_slot] = latency_ms;
+        next_slot = (next_slot + 1) % samples.size();
+        if (filled < samples.size()) filled++;
+    }
+
+    // Returns the requested percentile (0.0-1.0) in milliseconds, or -1 if
+    // fewer than min_samples latencies have been recorded.
+    long percentile(double p, size_t min_samples) const {
+        std::vector<long> sorted;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (filled == 0 || filled < min_samples) return -1;
+            sorted.assign(samples.begin(), samples.begin() + filled);
+        }
+        size_t rank = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank];
+    }
+
+private:
+    mutable std::mutex mtx;
+    std::vector<long> samples;
+    size_t next_slot = 0;
+    size_t filled = 0;
+};
+
+// Process-wide transport policy, configured from config.txt by configure_transport().
+TransportSettings g_transport_settings;
+CircuitBreaker g_circuit_breaker;
+LatencyTracker g_status_latency;
+
+void configure_transport(const TransportSettings& settings) {
+    g_transport_settings = settings;
+    g_circuit_breaker.configure(settings);
+}
+
+// Applies the configured connect/total timeouts to an easy handle.
+// Without these, libcurl waits indefinitely on a stalled transfer.
+void apply_request_timeouts(CURL *curl, const TransportSettings& settings) {
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, settings.connect_timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, settings.request_timeout_ms);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L); // Timeouts must not rely on SIGALRM in multi-threaded use
+}
+
+// CURLOPT_SOCKOPTFUNCTION callback: sizes the kernel receive buffer of each new
+// connection. It runs before connect() so the TCP window scale is negotiated for it.
+static int set_receive_buffer(void *clientp, curl_socket_t fd, curlsocktype purpose) {
+    const TransportProfile* profile = static_cast<const TransportProfile*>(clientp);
+    if (purpose == CURLSOCKTYPE_IPCXN) {
+        int bytes = static_cast<int>(profile->socket_rcvbuf_bytes);
+        // Best effort: the kernel clamps to net.core.rmem_max, and a failure is not worth dropping the request.
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+    }
+    return CURL_SOCKOPT_OK;
+}
+
+// Applies a transport profile's connection-level options to an easy handle.
+// `profile` must outlive the handle (entries of TRANSPORT_PROFILES do).
+void apply_transport_profile(CURL *curl, const TransportProfile& profile) {
+    if (profile.http_version != CURL_HTTP_VERSION_NONE) {
+        curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, profile.http_version);
+    }
+    if (profile.tcp_nodelay) {
+        curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+    }
+    if (profile.tcp_keepalive_idle_s > 0) {
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, profile.tcp_keepalive_idle_s);
+        curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, profile.tcp_keepalive_idle_s);
+    }
+    if (profile.receive_buffer_bytes > 0) {
+        curl_easy_setopt(curl, CURLOPT_BUFFERSIZE, profile.receive_buffer_bytes);
+    }
+    if (profile.socket_rcvbuf_bytes > 0) {
+        curl_easy_setopt(curl, CURLOPT_SOCKOPTFUNCTION, set_receive_buffer);
+        curl_easy_setopt(curl, CURLOPT_SOCKOPTDATA, const_cast<TransportProfile*>(&profile));
+    }
+    if (profile.accept_encoding) {
+        curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, ""); // Empty string: every encoding libcurl was built with
+    }
+    if (profile.pipewait) {
+        curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    }
+}
+
+// Applies timeouts and the configured transport profile to an easy handle.
+void apply_transport_settings(CURL *curl, const TransportSettings& settings) {
+    apply_request_timeouts(curl, settings);
+    const TransportProfile* profile = find_transport_profile(settings.profile);
+    if (profile) {
+        apply_transport_profile(curl, *profile);
+    }
+}
+
+// Returns true if an outcome indicates the API (or the path to it) is unhealthy.
+// Client errors such as 400/401 are the caller's fault and do not count.
+bool is_breaker_failure(CURLcode res, long http_code) {
+    return res != CURLE_OK || http_code >= 500 || http_code == 429;
+}
+
+// --- HTTP Runtime ---
+// Process-wide libcurl state, set up once instead of on every send. It calls
+// curl_global_init once, which initializes the TLS library. A share handle
+// lets DNS results and TLS sessions be reused across easy handles. The
+// connection cache is deliberately not shared: libcurl does not support one
+// connection cache being used by transfers on several threads at once, and the
+// warm-up thread runs while the sending thread does. Easy handles are pooled,
+// so each keeps its parsed CA store and its own open connection, and
+// curl_easy_reset() between uses keeps both. Optionally, a background thread
+// connects PREWARM_CONNECTIONS pooled handles to the API host at launch, so the
+// first send gets a handle that is already connected, and re-uses those
+// connections every KEEPWARM_INTERVAL_MS so the server does not close them as idle.
+
+// Startup timings reported by print_startup_metrics().
+struct StartupMetrics {
+    double runtime_init_ms = 0.0;    // curl_global_init + share handle setup
+    double ready_after_ms = 0.0;     // Process start until the runtime was ready
+    long prewarm_requested = 0;
+    long prewarm_opened = 0;         // Warm-up requests that completed
+    double prewarm_ms = -1.0;        // Duration of the first warm-up round, -1 if not finished
+};
+
+class HttpRuntime {
+public:
+    static HttpRuntime& instance() {
+        static HttpRuntime runtime;
+        return runtime;
+    }
+
+    // Initializes libcurl and the share handle. Only the first call does work.
+    void start() {
+        std::lock_guard<std::mutex> lock(pool_mtx);
+        if (started) return;
+        TraceSpan span("runtime.start");
+        const auto begin = std::chrono::steady_clock::now();
+        curl_global_init(CURL_GLOBAL_ALL);
+        share = curl_share_init();
+        if (share) {
+            curl_share_setopt(share, CURLSHOPT_LOCKFUNC, &HttpRuntime::lock_share);
+            curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, &HttpRuntime::unlock_share);
+            curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+            curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        }
+        const auto end = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> metrics_lock(metrics_mtx);
+        startup.runtime_init_ms = std::chrono::duration<double, std::milli>(end - begin).count();
+        startup.ready_after_ms = std::chrono::duration<double, std::milli>(end - g_process_start).count();
+        started = true;
+    }
+
+    // Returns a pooled easy handle attached to the share handle, or nullptr on failure.
+    CURL* acquire() {
+        start();
+        std::lock_guard<std::mutex> lock(pool_mtx);
+        if (!idle.empty()) {
+            CURL *curl = idle.back();
+            idle.pop_back();
+            return curl;
+        }
+        CURL *curl = curl_easy_init();
+        if (curl && share) curl_easy_setopt(curl, CURLOPT_SHARE, share);
+        return curl;
+    }
+
+    // Returns a handle to the pool. Options are reset; caches and connections are kept.
+    void release(CURL *curl) {
+        if (!curl) return;
+        curl_easy_reset(curl);
+        if (share) curl_easy_setopt(curl, CURLOPT_SHARE, share);
+        std::lock_guard<std::mutex> lock(pool_mtx);
+        idle.push_back(curl);
+    }
+
+    // Starts opening `connections` connections to the API host in the background,
+    // repeating every keepwarm_interval_ms (0: once) until the process exits.
+    void prewarm_async(long connections, long keepwarm_interval_ms) {
+        if (connections <= 0 || warmer.joinable()) return;
+        start();
+        {
+            std::lock_guard<std::mutex> lock(metrics_mtx);
+            startup.prewarm_requested = connections;
+        }
+        warmer = std::thread(&HttpRuntime::keep_warm, this, connections, keepwarm_interval_ms);
+    }
+
+    StartupMetrics metrics() const {
+        std::lock_guard<std::mutex> lock(metrics_mtx);
+        return startup;
+    }
+
+    ~HttpRuntime() {
+        {
+            std::lock_guard<std::mutex> lock(warm_mtx);
+            stopping = true; // Also aborts warm-up transfers in progress (see abort_if_stopping)
+            for (curl_socket_t fd : warm_sockets) shutdown(fd, SHUT_RDWR); // Wakes transfers blocked on them
+        }
+        warm_wake.notify_one();
+        if (warmer.joinable()) warmer.join();
+        for (CURL *curl : idle) curl_easy_cleanup(curl);
+        if (share) curl_share_cleanup(share);
+        if (started) curl_global_cleanup();
+    }
+
+private:
+    HttpRuntime() {}
+
+    static void lock_share(CURL *, curl_lock_data data, curl_lock_access, void *userptr) {
+        static_cast<HttpRuntime*>(userptr)->share_mutexes[data].lock();
+    }
+    static void unlock_share(CURL *, curl_lock_data data, void *userptr) {
+        static_cast<HttpRuntime*>(userptr)->share_mutexes[data].unlock();
+    }
+
+    // CURLOPT_XFERINFOFUNCTION of warm-up transfers: aborts them once the
+    // runtime is shutting down. Transfers blocked on a socket are woken by the
+    // destructor shutting the socket down; this catches the rest (e.g. DNS).
+    static int abort_if_stopping(void *clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+        return static_cast<HttpRuntime*>(clientp)->stopping.load() ? 1 : 0;
+    }
+
+    // CURLOPT_OPENSOCKETFUNCTION / CURLOPT_CLOSESOCKETFUNCTION of warm-up
+    // transfers: track the sockets of warmed connections (which outlive the
+    // transfer) so the destructor can shut them down.
+    static curl_socket_t open_warm_socket(void *clientp, curlsocktype, struct curl_sockaddr *address) {
+        HttpRuntime *runtime = static_cast<HttpRuntime*>(clientp);
+        curl_socket_t fd = socket(address->family, address->socktype, address->protocol);
+        if (fd == CURL_SOCKET_BAD) return fd;
+        std::lock_guard<std::mutex> lock(runtime->warm_mtx);
+        runtime->warm_sockets.push_back(fd);
+        return fd;
+    }
+    static int close_warm_socket(void *clientp, curl_socket_t fd) {
+        HttpRuntime *runtime = static_cast<HttpRuntime*>(clientp);
+        {
+            std::lock_guard<std::mutex> lock(runtime->warm_mtx);
+            std::vector<curl_socket_t>& sockets = runtime->warm_sockets;
+            sockets.erase(std::remove(sockets.begin(), sockets.end(), fd), sockets.end());
+        }
+        return close(fd);
+    }
+
+    // One warm-up round: a HEAD request to the API root on each of `connections`
+    // pooled handles at once, one thread per handle. Each easy handle keeps the
+    // connection in its own cache, so once the handles are back in the pool
+    // acquire() hands out handles that are already connected; the shared DNS
+    // and TLS session caches are filled as well. Later rounds take the same
+    // handles from the pool and re-use their connections. Returns the number
+    // of requests that completed.
+    long warm_connections(long connections) {
+        std::vector<CURL*> handles;
+        for (long i = 0; i < connections && !stopping; ++i) {
+            CURL *curl = acquire();
+            if (!curl) break;
+            curl_easy_setopt(curl, CURLOPT_URL, (g_transport_settings.api_base_url + "/").c_str());
+            curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+            curl_easy_setopt(curl, CURLOPT_USERAGENT, "cpp-sms-app/1.0");
+            curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+            curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, &HttpRuntime::abort_if_stopping);
+            curl_easy_setopt(curl, CURLOPT_XFERINFODATA, this);
+            curl_easy_setopt(curl, CURLOPT_OPENSOCKETFUNCTION, &HttpRuntime::open_warm_socket);
+            curl_easy_setopt(curl, CURLOPT_OPENSOCKETDATA, this);
+            curl_easy_setopt(curl, CURLOPT_CLOSESOCKETFUNCTION, &HttpRuntime::close_warm_socket);
+            curl_easy_setopt(curl, CURLOPT_CLOSESOCKETDATA, this);
+            apply_transport_settings(curl, g_transport_settings);
+            handles.push_back(curl);
+        }
+        std::vector<CURLcode> results(handles.size(), CURLE_FAILED_INIT);
+        std::vector<std::thread> transfers;
+        for (size_t i = 0; i < handles.size(); ++i) {
+            transfers.emplace_back([&handles, &results, i]() { results[i] = curl_easy_perform(handles[i]); });
+        }
+        for (std::thread& transfer : transfers) transfer.join();
+        long opened = static_cast<long>(std::count(results.begin(), results.end(), CURLE_OK));
+        for (CURL *curl : handles) release(curl); // Connected handles go back to the pool for acquire()
+        return opened;
+    }
+
+    void keep_warm(long connections, long keepwarm_interval_ms) {
+        const auto begin = std::chrono::steady_clock::now();
+        long opened = warm_connections(connections);
+        {
+            std::lock_guard<std::mutex> lock(metrics_mtx);
+            startup.prewarm_opened = opened;
+            startup.prewarm_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+        }
+        if (keepwarm_interval_ms <= 0) return;
+        std::unique_lock<std::mutex> lock(warm_mtx);
+        while (!warm_wake.wait_for(lock, std::chrono::milliseconds(keepwarm_interval_ms), [this] { return stopping.load(); })) {
+            lock.unlock();
+            warm_connections(connections);
+            lock.lock();
+        }
+    }
+
+    bool started = false;
+    CURLSH *share = nullptr;
+    std::mutex share_mutexes[CURL_LOCK_DATA_LAST];
+    std::mutex pool_mtx;
+    std::vector<CURL*> idle;
+    mutable std::mutex metrics_mtx;
+    StartupMetrics startup;
+    std::thread warmer;
+    std::mutex warm_mtx;                 // Guards warm_sockets and wakes keep_warm
+    std::condition_variable warm_wake;
+    std::vector<curl_socket_t> warm_sockets; // Open sockets of warmed connections
+    std::atomic<bool> stopping{false};   // Also read by warm-up transfers without warm_mtx
+};
+
+// Initializes the HTTP runtime for a command that talks to the API and starts
+// pre-warming connections if PREWARM_CONNECTIONS is set.
+void start_http_runtime(const TransportSettings& settings) {
+    HttpRuntime::instance().start();
+    HttpRuntime::instance().prewarm_async(settings.prewarm_connections, settings.keepwarm_interval_ms);
 }
 
-// Helper function to URL-encode a string using libcurl
-// URL encoding ensures that data sent in URLs or POST bodies is correctly interpreted,
-// especially special characters.
-// - curl: A CURL easy handle (used by curl_easy_escape)
-// - value: The string to be URL-encoded
-// Returns the URL-encoded string. Returns an empty string on failure.
-std::string url_encode(CURL *curl, const std::string &value) {
-    // curl_easy_escape URL-encodes the given string.
-    // The returned string must be freed with curl_free.
-    char *output = curl_easy_escape(curl, value.c_str(), value.length());
-    if (output) {
-        std::string result(output);
-        curl_free(output); // Free the allocated memory
-        return result;
+void print_startup_metrics() {
+    StartupMetrics m = HttpRuntime::instance().metrics();
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "INFO: Startup: libcurl/TLS init " << m.runtime_init_ms << " ms, runtime ready "
+              << m.ready_after_ms << " ms after launch";
+    if (m.prewarm_requested > 0) {
+        if (m.prewarm_ms >= 0.0) {
+            std::cout << ", " << m.prewarm_opened << "/" << m.prewarm_requested << " warm-up request(s) completed in " << m.prewarm_ms << " ms";
+        } else {
+            std::cout << ", " << m.prewarm_requested << " warm-up request(s) still in progress";
+        }
     }
-    return ""; // Return empty string if encoding fails
+    std::cout << "." << std::endl;
 }
 
 // Sends an SMS using the Twilio API.
@@ -226,17 +2409,17 @@ std::string url_encode(CURL *curl, const std::string &value) {
 // - message_body: The text of the SMS message.
 // - api_response_str: A reference to a string to store the full API response from Twilio.
 // Forward declaration for mocked_send_sms
-bool mocked_send_sms(const std::string &account_sid,
-                     const std::string &auth_token,
+bool mocked_send_sms(const SecretString &account_sid,
+                     const SecretString &auth_token,
                      const std::string &to_number,
                      const std::string &from_number,
                      const std::string &message_body,
                      std::string &api_response_str);
 
 // Returns true if Twilio indicates success (HTTP 201), false otherwise.
-// Returns true if Twilio indicates success (HTTP 201), false otherwise.
-bool send_sms(const std::string &account_sid,
-              const std::string &auth_token,
+// Requests are rejected locally while the circuit breaker is open.
+bool send_sms(const SecretString &account_sid,
+              const SecretString &auth_token,
               const std::string &to_number,
               const std::string &from_number,
               const std::string &message_body,
@@ -244,22 +2427,29 @@ bool send_sms(const std::string &account_sid,
 
     long current_http_code = 0;
     bool success_status = false;
+    CURLcode res = CURLE_OK;
+    StageTimings timings;
+    int64_t response_started = trace_clock();
     api_response_str.clear();
 
     if (g_test_ctx.test_mode && g_test_ctx.mock_sms_behavior != REAL) {
         success_status = mocked_send_sms(account_sid, auth_token, to_number, from_number, message_body, api_response_str);
         current_http_code = g_test_ctx.mock_response_code; // Mock sets this global for send_sms to retrieve
+    } else if (!g_circuit_breaker.allow_request()) {
+        std::cerr << "\nERROR: Circuit breaker is open after repeated Twilio API failures; SMS not sent. Retry later." << std::endl;
+        record_unsent_result(to_number.data(), to_number.length(), RESULT_SKIPPED,
+                             count_sms_segments(message_body.data(), message_body.length()).segments);
+        return false;
     } else {
-        CURL *curl;
-        CURLcode res;
-        curl_global_init(CURL_GLOBAL_ALL);
-        curl = curl_easy_init();
+        CURL *curl = HttpRuntime::instance().acquire();
 
         if (curl) {
-            std::string url = "https://api.twilio.com/2010-04-01/Accounts/" + account_sid + "/Messages.json";
+            int64_t encode_started = trace_clock();
+            std::string url = g_transport_settings.api_base_url + "/2010-04-01/Accounts/" + account_sid.c_str() + "/Messages.json";
             std::string post_data = "To=" + url_encode(curl, to_number) +
                                     "&From=" + url_encode(curl, from_number) +
                                     "&Body=" + url_encode(curl, message_body);
+            trace_since("request.encode", encode_started);
 
             curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
             curl_easy_setopt(curl, CURLOPT_POSTFIELDS, post_data.c_str());
@@ -268,8 +2458,12 @@ bool send_sms(const std::string &account_sid,
             curl_easy_setopt(curl, CURLOPT_USERAGENT, "cpp-sms-app/1.0");
             curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
             curl_easy_setopt(curl, CURLOPT_WRITEDATA, &api_response_str);
+            apply_transport_settings(curl, g_transport_settings);
 
+            int64_t request_started = trace_clock();
             res = curl_easy_perform(curl);
+            trace_since("request.http", request_started);
+            response_started = trace_clock();
 
             if (res != CURLE_OK) {
                 // Error message will be printed below using common logging section
@@ -285,14 +2479,24 @@ bool send_sms(const std::string &account_sid,
                 curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &current_http_code);
                 success_status = (current_http_code == 201); // Twilio success for SMS creation
             }
-            curl_easy_cleanup(curl);
+            timings = read_stage_timings(curl);
+            trace_curl_stages(timings, request_started);
+            if (is_breaker_failure(res, current_http_code)) {
+                g_circuit_breaker.record_failure();
+            } else {
+                g_circuit_breaker.record_success();
+            }
+            HttpRuntime::instance().release(curl);
         } else {
             std::cerr << "\nCRITICAL: Failed to initialize libcurl easy handle." << std::endl;
+            g_circuit_breaker.record_failure(); // Releases a half-open probe slot
             success_status = false; // Cannot proceed
         }
-        curl_global_cleanup();
     }
 
+    record_send_result(to_number.data(), to_number.length(), api_response_str.data(), api_response_str.length(),
+                       current_http_code, res, timings, count_sms_segments(message_body.data(), message_body.length()).segments);
+
     // Common logging based on outcome
     std::cout << "\nINFO: HTTP response code from Twilio: " << current_http_code << std::endl;
     std::cout << "INFO: Full API Response from Twilio: " << api_response_str << std::endl;
@@ -316,13 +2520,323 @@ bool send_sms(const std::string &account_sid,
              std::cerr << "\nERROR: SMS sending failed due to an unspecified error." << std::endl;
         }
     }
+    trace_since("response.handle", response_started);
     return success_status;
 }
 
+// Queries the current status of a previously sent message (GET .../Messages/<sid>.json).
+// Status queries are idempotent, so with HEDGE_STATUS_QUERIES=Y a second identical
+// request is issued if the first has not completed within the recent p95 latency
+// (or HEDGE_FALLBACK_DELAY_MS until enough samples exist). Whichever response
+// arrives first is used and the other transfer is abandoned.
+// - message_sid: The SID returned by Twilio when the message was created (SM...).
+// - api_response_str: Receives the JSON body of the winning response.
+// Returns true if Twilio answered with HTTP 200, false otherwise.
+bool fetch_message_status(const SecretString &account_sid,
+                          const SecretString &auth_token,
+                          const std::string &message_sid,
+                          std::string &api_response_str) {
+    TraceSpan span("status.query");
+    api_response_str.clear();
+    if (!g_circuit_breaker.allow_request()) {
+        std::cerr << "\nERROR: Circuit breaker is open after repeated Twilio API failures; status query not sent. Retry later." << std::endl;
+        return false;
+    }
+
+    CURLM *multi = curl_multi_init();
+    if (!multi) {
+        std::cerr << "\nCRITICAL: Failed to initialize libcurl multi handle." << std::endl;
+        g_circuit_breaker.record_failure();
+        return false;
+    }
+
+    const std::string url = g_transport_settings.api_base_url + "/2010-04-01/Accounts/" + account_sid.c_str() + "/Messages/" + message_sid + ".json";
+    CURL *handles[2] = {nullptr, nullptr};
+    std::string responses[2];
+    int launched = 0;
+    auto launch = [&]() -> bool {
+        CURL *curl = HttpRuntime::instance().acquire();
+        if (!curl) return false;
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_USERNAME, account_sid.c_str());
+        curl_easy_setopt(curl, CURLOPT_PASSWORD, auth_token.c_str());
+        curl_easy_setopt(curl, CURLOPT_USERAGENT, "cpp-sms-app/1.0");
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responses[launched]);
+        apply_transport_settings(curl, g_transport_settings);
+        handles[launched++] = curl;
+        curl_multi_add_handle(multi, curl);
+        return true;
+    };
+
+    long hedge_delay_ms = -1; // -1: hedging disabled for this query
+    if (g_transport_settings.hedge_status_queries) {
+        hedge_delay_ms = g_status_latency.percentile(0.95, 20);
+        if (hedge_delay_ms < 0) hedge_delay_ms = g_transport_settings.hedge_fallback_delay_ms;
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    int winner = -1, fallback = -1, finished = 0; // fallback: completed transfer without a 2xx, reported if no winner
+    bool hedge_attempted = false;
+    CURLcode res = CURLE_FAILED_INIT;
+    if (launch()) {
+        while (winner < 0 && finished < launched) {
+            int running = 0;
+            curl_multi_perform(multi, &running);
+
+            CURLMsg *msg;
+            int queued = 0;
+            while ((msg = curl_multi_info_read(multi, &queued)) != nullptr) {
+                if (msg->msg != CURLMSG_DONE) continue;
+                finished++;
+                int index = (msg->easy_handle == handles[0]) ? 0 : 1;
+                res = msg->data.result;
+                if (res != CURLE_OK || winner >= 0) continue;
+                // Only a 2xx wins; a fast 5xx from one transfer must not beat a slower 200 from the other.
+                long code = 0;
+                curl_easy_getinfo(handles[index], CURLINFO_RESPONSE_CODE, &code);
+                if (code >= 200 && code < 300) {
+                    winner = index;
+                } else {
+                    fallback = index;
+                }
+            }
+            if (winner >= 0 || finished == launched) break;
+
+            long elapsed_ms = static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - started).count());
+            long wait_ms = 100;
+            if (!hedge_attempted && hedge_delay_ms >= 0) {
+                if (elapsed_ms >= hedge_delay_ms) {
+                    hedge_attempted = true; // Set first so a failed launch() is not retried in a loop
+                    std::cout << "INFO: Status query exceeded " << hedge_delay_ms << " ms; sending hedged request." << std::endl;
+                    if (!launch()) {
+                        std::cerr << "WARNING: Unable to start the hedged status query; waiting for the first one." << std::endl;
+                    }
+                    continue;
+                }
+                wait_ms = std::min(wait_ms, hedge_delay_ms - elapsed_ms);
+            }
+            curl_multi_poll(multi, nullptr, 0, static_cast<int>(wait_ms), nullptr);
+        }
+    } else {
+        std::cerr << "\nCRITICAL: Failed to initialize libcurl easy handle." << std::endl;
+    }
+
+    long http_code = 0;
+    int chosen = (winner >= 0) ? winner : fallback;
+    if (chosen >= 0) {
+        res = CURLE_OK;
+        curl_easy_getinfo(handles[chosen], CURLINFO_RESPONSE_CODE, &http_code);
+        api_response_str = responses[chosen];
+        if (winner >= 0) {
+            g_status_latency.record(static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - started).count()));
+        }
+    } else if (launched > 0) {
+        std::cerr << "\nERROR: Status query failed: " << curl_easy_strerror(res) << std::endl;
+    }
+    if (is_breaker_failure(res, http_code)) {
+        g_circuit_breaker.record_failure();
+    } else {
+        g_circuit_breaker.record_success();
+    }
+
+    for (int i = 0; i < launched; ++i) {
+        curl_multi_remove_handle(multi, handles[i]);
+        HttpRuntime::instance().release(handles[i]);
+    }
+    curl_multi_cleanup(multi);
+
+    std::cout << "\nINFO: HTTP response code from Twilio: " << http_code << std::endl;
+    std::cout << "INFO: Message status response from Twilio: " << api_response_str << std::endl;
+    return http_code == 200;
+}
+
+
+// --- Transport Benchmark ---
+// Command-line options of `--bench-transport`.
+struct BenchmarkOptions {
+    long requests = 200;
+    long concurrency = 8;
+    std::string ca_file; // --cacert: extra CA bundle, e.g. a local server's self-signed certificate
+    bool insecure = false; // --insecure: skip TLS verification (benchmark only)
+};
+
+// Outcome of running one transport profile against a benchmark endpoint.
+struct BenchmarkResult {
+    std::string profile;
+    long succeeded = 0;
+    long failed = 0;      // Transport errors and non-2xx responses
+    long http_errors = 0; // Of `failed`, transfers that completed with a non-2xx status
+    long last_http_error = 0;
+    double wall_ms = 0.0;
+    curl_off_t bytes_downloaded = 0;
+    std::vector<double> latencies_ms; // Per-request total time reported by libcurl
+};
+
+// Returns the p-th percentile (0.0-1.0) of `values`, reordering them. 0 if empty.
+double percentile_of(std::vector<double>& values, double p) {
+    if (values.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+// Sends `requests` form POSTs to `url` using `profile`, keeping up to `concurrency`
+// transfers in flight on one multi handle so connections are reused (and
+// multiplexed when the profile negotiates HTTP/2).
+BenchmarkResult benchmark_transport_profile(const std::string& url, const TransportProfile& profile,
+                                            const BenchmarkOptions& options) {
+    const long requests = options.requests;
+    BenchmarkResult result;
+    result.profile = profile.name;
+    // Representative body: same shape and size as a short SMS send.
+    static const std::string post_data = "To=%2B15550000000&From=%2B15550000001&Body=Transport%20benchmark%20message";
+
+    CURLM *multi = curl_multi_init();
+    if (!multi) {
+        std::cerr << "CRITICAL: Failed to initialize libcurl multi handle." << std::endl;
+        result.failed = requests;
+        return result;
+    }
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+    long slots = std::min(options.concurrency, requests);
+    std::vector<CURL*> handles;
+    std::vector<std::string> sinks(static_cast<size_t>(slots));
+    for (long i = 0; i < slots; ++i) {
+        CURL *curl = curl_easy_init();
+        if (!curl) break;
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, post_data.c_str());
+        curl_easy_setopt(curl, CURLOPT_USERAGENT, "cpp-sms-app/1.0");
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sinks[static_cast<size_t>(i)]);
+        if (!options.ca_file.empty()) {
+            curl_easy_setopt(curl, CURLOPT_CAINFO, options.ca_file.c_str());
+        }
+        if (options.insecure) {
+            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+            curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+        }
+        apply_request_timeouts(curl, g_transport_settings);
+        apply_transport_profile(curl, profile);
+        handles.push_back(curl);
+    }
+    if (handles.empty()) {
+        std::cerr << "CRITICAL: Failed to initialize libcurl easy handle." << std::endl;
+        curl_multi_cleanup(multi);
+        result.failed = requests;
+        return result;
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    long launched = 0, completed = 0;
+    for (CURL *curl : handles) {
+        curl_multi_add_handle(multi, curl);
+        launched++;
+    }
+    while (completed < launched) {
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        CURLMsg *msg;
+        int queued = 0;
+        while ((msg = curl_multi_info_read(multi, &queued)) != nullptr) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            CURL *curl = msg->easy_handle;
+            completed++;
+            long http_code = 0;
+            if (msg->data.result == CURLE_OK) {
+                curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+            }
+            if (http_code >= 200 && http_code < 300) {
+                curl_off_t total_us = 0, downloaded = 0;
+                curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total_us);
+                curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+                result.latencies_ms.push_back(total_us / 1000.0);
+                result.bytes_downloaded += downloaded;
+                result.succeeded++;
+            } else {
+                result.failed++;
+                if (msg->data.result == CURLE_OK) {
+                    result.http_errors++;
+                    result.last_http_error = http_code;
+                }
+            }
+            curl_multi_remove_handle(multi, curl);
+            if (launched < requests) {
+                size_t slot = static_cast<size_t>(std::find(handles.begin(), handles.end(), curl) - handles.begin());
+                sinks[slot].clear();
+                curl_multi_add_handle(multi, curl);
+                launched++;
+            }
+        }
+        if (completed < launched) {
+            curl_multi_poll(multi, nullptr, 0, 100, nullptr);
+        }
+    }
+    result.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+    for (CURL *curl : handles) curl_easy_cleanup(curl);
+    curl_multi_cleanup(multi);
+    return result;
+}
+
+// Runs every transport profile against `url` (normally a local test server)
+// and prints a comparison table, so TRANSPORT_PROFILE can be chosen from data.
+void run_transport_benchmark(const std::string& url, const BenchmarkOptions& options) {
+    HttpRuntime::instance().start(); // Profiles use their own handles so they do not share connections
+    const curl_version_info_data *version = curl_version_info(CURLVERSION_NOW);
+    if (!(version->features & CURL_VERSION_HTTP2)) {
+        std::cout << "WARNING: libcurl " << version->version << " was built without HTTP/2; http2 profiles will use HTTP/1.1 and h2c will fail." << std::endl;
+    }
+    if (url.rfind("https://", 0) != 0) {
+        std::cout << "WARNING: HTTP/2 is only negotiated over https://; http2 and compressed will use HTTP/1.1 against " << url
+                  << " (h2c needs a server that accepts cleartext HTTP/2)." << std::endl;
+    }
+    if (options.insecure) {
+        std::cout << "WARNING: TLS certificate verification is disabled for this benchmark (--insecure)." << std::endl;
+    }
+
+    std::cout << "\n--- Transport Benchmark: " << url << " (" << options.requests << " requests, concurrency " << options.concurrency << ") ---" << std::endl;
+    std::cout << std::left << std::setw(14) << "Profile" << std::right
+              << std::setw(8) << "OK" << std::setw(8) << "Failed" << std::setw(10) << "Req/s"
+              << std::setw(10) << "p50 ms" << std::setw(10) << "p95 ms" << std::setw(10) << "p99 ms"
+              << std::setw(12) << "Bytes in" << std::endl;
+
+    std::string fastest;
+    double fastest_p95 = 0.0;
+    for (const TransportProfile& profile : TRANSPORT_PROFILES) {
+        BenchmarkResult r = benchmark_transport_profile(url, profile, options);
+        double throughput = r.wall_ms > 0.0 ? r.succeeded * 1000.0 / r.wall_ms : 0.0;
+        double p50 = percentile_of(r.latencies_ms, 0.50);
+        double p95 = percentile_of(r.latencies_ms, 0.95);
+        double p99 = percentile_of(r.latencies_ms, 0.99);
+        std::cout << std::left << std::setw(14) << r.profile << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(8) << r.succeeded << std::setw(8) << r.failed << std::setw(10) << throughput
+                  << std::setw(10) << p50 << std::setw(10) << p95 << std::setw(10) << p99
+                  << std::setw(12) << static_cast<long long>(r.bytes_downloaded) << std::endl;
+        if (r.http_errors > 0) {
+            std::cout << "WARNING: " << r.profile << ": " << r.http_errors << " response(s) were not 2xx (last HTTP "
+                      << r.last_http_error << "); they are counted as failed." << std::endl;
+        }
+        if (r.failed == 0 && r.succeeded > 0 && (fastest.empty() || p95 < fastest_p95)) {
+            fastest = r.profile;
+            fastest_p95 = p95;
+        }
+    }
+    if (!fastest.empty()) {
+        std::cout << "\nINFO: Lowest p95 latency: TRANSPORT_PROFILE=" << fastest << std::endl;
+    } else {
+        std::cout << "\nWARNING: No profile completed all requests; check that the benchmark server is reachable." << std::endl;
+    }
+}
 
 // Mocked version of send_sms for testing purposes
-bool mocked_send_sms(const std::string &account_sid,
-                     const std::string &auth_token,
+bool mocked_send_sms(const SecretString &account_sid,
+                     const SecretString &auth_token,
                      const std::string &to_number,
                      const std::string &from_number,
                      const std::string &message_body,
@@ -360,72 +2874,793 @@ bool mocked_send_sms(const std::string &account_sid,
             if (g_test_ctx.mock_response_code >= 200 && g_test_ctx.mock_response_code <= 299) {
                 g_test_ctx.mock_response_code = 400;
             }
-            if (g_test_ctx.mock_api_response_str.find("SMmockedsuccessfulsid") != std::string::npos && g_test_ctx.mock_api_response_str.length() < 100) {
-                api_response_str = "{\"code\": 21211, \"message\": \"The 'To' number is not a valid phone number.\", \"more_info\": \"https://www.twilio.com/docs/errors/21211\", \"status\": 400}";
+            if (g_test_ctx.mock_api_response_str.find("SMmockedsuccessfulsid") != std::string::npos && g_test_ctx.mock_api_response_str.length() < 100) {
+                api_response_str = "{\"code\": 21211, \"message\": \"The 'To' number is not a valid phone number.\", \"more_info\": \"https://www.twilio.com/docs/errors/21211\", \"status\": 400}";
+            } else {
+                api_response_str = g_test_ctx.mock_api_response_str;
+            }
+            return false;
+
+        case MOCK_URL_ENCODE_FAIL:
+            std::cout << "MOCK_SEND_SMS: Simulating MOCK_URL_ENCODE_FAIL (leads to generic parameter error)." << std::endl;
+             if (g_test_ctx.mock_response_code >= 200 && g_test_ctx.mock_response_code <= 299) {
+                g_test_ctx.mock_response_code = 400; // Typically a bad request
+            }
+            if (g_test_ctx.mock_api_response_str.find("SMmockedsuccessfulsid") != std::string::npos && g_test_ctx.mock_api_response_str.length() < 100) {
+                 api_response_str = "{\"code\": 21601, \"message\": \"Invalid Parameter (simulated URL encode fail)\", \"more_info\": \"https://www.twilio.com/docs/errors/21601\", \"status\": 400}";
+            } else {
+                api_response_str = g_test_ctx.mock_api_response_str;
+            }
+            return false;
+
+        case MOCK_PERFORM_FAIL:
+            std::cout << "MOCK_SEND_SMS: Simulating MOCK_PERFORM_FAIL (e.g., CURLE_COULDNT_CONNECT)." << std::endl;
+            g_test_ctx.mock_response_code = 0; // No HTTP response in this case
+            api_response_str = ""; // No API response body
+            // The actual error message for curl failure will be printed by the main send_sms function's real path recovery.
+            // Or, we can simulate the specific cerr message here for consistency in test output if needed.
+            // For now, send_sms will print its generic "curl_easy_perform() failed".
+            // Let's ensure the common logging in send_sms reflects this.
+            // This mock only needs to return false and set code to 0.
+            return false;
+
+        default:
+            std::cout << "MOCK_SEND_SMS: Unknown g_test_ctx.mock_sms_behavior!" << std::endl;
+            g_test_ctx.mock_response_code = 500; // Internal server error
+            api_response_str = "{\"code\": 99999, \"message\": \"Internal Mock Error\"}";
+            return false;
+    }
+}
+
+
+// Validates a phone number string.
+// Basic validation: checks if it's not empty and starts with '+'.
+// For more robust validation, a regex library or more specific checks would be needed.
+// - number: The phone number string to validate.
+// Returns true if the number seems valid, false otherwise.
+bool is_valid_phone_number(const char* number, size_t length) {
+    if (length == 0) return false;
+
+    if (number[0] != '+') return false;
+
+    // Check length: + followed by 7 to 15 digits. So total length 8 to 16.
+    if (length < 8 || length > 16) return false;
+
+    // Check if all characters after '+' are digits
+    // std::all_of returns true if the predicate returns true for all elements in the range.
+    // Here, it checks characters from the second one (index 1) to the end.
+    return std::all_of(number + 1, number + length, [](unsigned char c) { return c >= '0' && c <= '9'; });
+}
+
+bool is_valid_phone_number(const std::string& number) {
+    return is_valid_phone_number(number.data(), number.length());
+}
+
+// --- Bulk Message Representation ---
+// Compact per-message storage for batch sends. Instead of several heap-allocated
+// std::strings per message, a Message holds its recipient as packed digits, points
+// at a body stored in a per-chunk MessageArena, and keeps only the HTTP status and
+// SID of its response. The response itself is received into one SmallResponse
+// per in-flight send. Messages are recycled through a MessagePool, so memory use
+// is bounded by the chunk size rather than the size of the batch.
+
+// Number of messages read, sent and recycled together in batch mode.
+const size_t BATCH_CHUNK_MESSAGES = 4096;
+
+// An E.164 phone number stored as up to 15 packed decimal digits (two per byte).
+struct PackedPhoneNumber {
+    static const size_t MAX_DIGITS = 15;
+    unsigned char digit_count = 0;
+    unsigned char digits[(MAX_DIGITS + 1) / 2] = {};
+
+    // Packs a number such as "+15551234567". The caller must have validated it
+    // with is_valid_phone_number(). Returns false if it does not fit.
+    bool assign(const char* e164, size_t length) {
+        if (length < 2 || e164[0] != '+' || length - 1 > MAX_DIGITS) return false;
+        digit_count = 0;
+        std::fill(digits, digits + sizeof(digits), 0);
+        for (size_t i = 1; i < length; ++i) {
+            unsigned char value = static_cast<unsigned char>(e164[i] - '0');
+            if (value > 9) return false;
+            digits[digit_count / 2] |= (digit_count % 2 == 0) ? static_cast<unsigned char>(value << 4) : value;
+            digit_count++;
+        }
+        return true;
+    }
+
+    char digit(size_t index) const {
+        unsigned char byte = digits[index / 2];
+        return static_cast<char>('0' + ((index % 2 == 0) ? (byte >> 4) : (byte & 0x0F)));
+    }
+
+    // Appends the number in E.164 form ("+<digits>").
+    void append_to(std::string& out) const {
+        out.push_back('+');
+        for (size_t i = 0; i < digit_count; ++i) out.push_back(digit(i));
+    }
+
+    // Writes the number in E.164 form to `out` (at least MAX_DIGITS + 1 bytes,
+    // not NUL-terminated). Returns the number of characters written.
+    size_t write_to(char* out) const {
+        out[0] = '+';
+        for (size_t i = 0; i < digit_count; ++i) out[i + 1] = digit(i);
+        return digit_count + 1u;
+    }
+
+    std::string to_string() const {
+        std::string out;
+        append_to(out);
+        return out;
+    }
+
+    // Unique integer key for hashing: digit count in the top byte, digits as a number below.
+    uint64_t key() const {
+        uint64_t value = 0;
+        for (size_t i = 0; i < digit_count; ++i) value = value * 10 + static_cast<uint64_t>(digit(i) - '0');
+        return (static_cast<uint64_t>(digit_count) << 56) | value;
+    }
+};
+
+// Bump allocator for message bodies. Bodies are copied into large blocks and
+// released all at once by reset(), which keeps the blocks for the next chunk.
+class MessageArena {
+public:
+    explicit MessageArena(size_t block_size = 64 * 1024) : block_size(block_size) {}
+
+    // Copies `length` bytes into the arena and returns a pointer to the copy.
+    const char* store(const char* data, size_t length) {
+        if (length > block_size) {
+            // Oversized body: give it a dedicated block, freed on reset().
+            oversized.push_back(std::unique_ptr<char[]>(new char[length]));
+            std::copy(data, data + length, oversized.back().get());
+            return oversized.back().get();
+        }
+        if (blocks.empty() || offset + length > block_size) {
+            if (!blocks.empty()) current_block++;
+            if (current_block == blocks.size()) {
+                blocks.push_back(std::unique_ptr<char[]>(new char[block_size]));
+            }
+            offset = 0;
+        }
+        char* destination = blocks[current_block].get() + offset;
+        std::copy(data, data + length, destination);
+        offset += length;
+        return destination;
+    }
+
+    // Releases every stored body. Regular blocks are kept for reuse.
+    void reset() {
+        current_block = 0;
+        offset = 0;
+        oversized.clear();
+    }
+
+    size_t bytes_reserved() const { return blocks.size() * block_size; }
+
+private:
+    size_t block_size;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::vector<std::unique_ptr<char[]>> oversized;
+    size_t current_block = 0;
+    size_t offset = 0;
+};
+
+// Response body buffer that stays inline for typical Twilio responses and only
+// spills to the heap for unusually large ones.
+class SmallResponse {
+public:
+    static const size_t INLINE_CAPACITY = 1024;
+
+    void append(const char* data, size_t length) {
+        if (overflow.empty() && size + length <= INLINE_CAPACITY) {
+            std::copy(data, data + length, inline_data + size);
+            size += length;
+            return;
+        }
+        if (overflow.empty()) overflow.assign(inline_data, size);
+        overflow.append(data, length);
+    }
+
+    void clear() {
+        size = 0;
+        overflow.clear(); // Keeps capacity for the next message that overflows
+    }
+
+    const char* data() const { return overflow.empty() ? inline_data : overflow.data(); }
+    size_t length() const { return overflow.empty() ? size : overflow.size(); }
+    std::string to_string() const { return std::string(data(), length()); }
+
+private:
+    char inline_data[INLINE_CAPACITY];
+    size_t size = 0;
+    std::string overflow;
+};
+
+// One message of a batch. `body` points into the MessageArena of the current chunk.
+struct Message {
+    PackedPhoneNumber to;
+    const char* body = nullptr;
+    size_t body_length = 0;
+    long source_line = 0;   // Line in the batch file, for error reporting
+    long http_code = 0;
+    bool split = false;     // Send as numbered parts (SPLIT_LONG_MESSAGES)
+    char sid[40] = {};      // Message SID from the (last part's) response, empty if none
+
+    void clear() {
+        to = PackedPhoneNumber();
+        body = nullptr;
+        body_length = 0;
+        source_line = 0;
+        http_code = 0;
+        split = false;
+        sid[0] = '\0';
+    }
+};
+
+// Recycles Message objects so steady-state batch processing does not allocate.
+class MessagePool {
+public:
+    Message* acquire() {
+        if (free_list.empty()) {
+            storage.push_back(std::unique_ptr<Message>(new Message()));
+            return storage.back().get();
+        }
+        Message* message = free_list.back();
+        free_list.pop_back();
+        return message;
+    }
+
+    void release(Message* message) {
+        message->clear();
+        free_list.push_back(message);
+    }
+
+    size_t allocated() const { return storage.size(); }
+
+private:
+    std::vector<std::unique_ptr<Message>> storage;
+    std::vector<Message*> free_list;
+};
+
+// libcurl write callback that collects the response into a SmallResponse.
+size_t SmallResponseWriteCallback(void *contents, size_t size, size_t nmemb, SmallResponse *response) {
+    size_t length = size * nmemb;
+    try {
+        response->append(static_cast<const char*>(contents), length);
+    } catch (std::bad_alloc &e) {
+        std::cerr << "CRITICAL: Memory allocation failed in SmallResponseWriteCallback." << std::endl;
+        return 0;
+    }
+    return length;
+}
+
+// Appends `data` to `out` in application/x-www-form-urlencoded form, matching
+// curl_easy_escape() but without allocating a temporary string per field.
+void append_form_encoded(std::string& out, const char* data, size_t length) {
+    static const char hex_digits[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char c = static_cast<unsigned char>(data[i]);
+        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+            c == '-' || c == '.' || c == '_' || c == '~') {
+            out.push_back(static_cast<char>(c));
+        } else {
+            out.push_back('%');
+            out.push_back(hex_digits[c >> 4]);
+            out.push_back(hex_digits[c & 0x0F]);
+        }
+    }
+}
+
+// Fields of one batch line, pointing into the line itself.
+struct BatchLineFields {
+    const char* to = nullptr;
+    size_t to_length = 0;
+    const char* body = nullptr;
+    size_t body_length = 0;
+};
+
+// Locates the recipient and body of a batch line "<to_number>,<message body>"
+// within [begin, end), trimming surrounding blanks. Returns false if there is no comma.
+bool split_batch_line(const char* begin, const char* end, BatchLineFields& fields) {
+    const char* comma = std::find(begin, end, ',');
+    if (comma == end) return false;
+    auto is_blank = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
+    const char* to_begin = begin;
+    const char* to_end = comma;
+    while (to_begin < to_end && is_blank(*to_begin)) to_begin++;
+    while (to_end > to_begin && is_blank(to_end[-1])) to_end--;
+    const char* body_begin = comma + 1;
+    const char* body_end = end;
+    while (body_begin < body_end && is_blank(*body_begin)) body_begin++;
+    while (body_end > body_begin && is_blank(body_end[-1])) body_end--;
+    fields.to = to_begin;
+    fields.to_length = static_cast<size_t>(to_end - to_begin);
+    fields.body = body_begin;
+    fields.body_length = static_cast<size_t>(body_end - body_begin);
+    return true;
+}
+
+// Splits a batch line into `message`, copying the body into `arena`. Returns
+// false if the line is malformed or the recipient fails is_valid_phone_number().
+bool parse_batch_line(const std::string& line, Message& message, MessageArena& arena) {
+    BatchLineFields fields;
+    if (!split_batch_line(line.data(), line.data() + line.size(), fields) ||
+        !is_valid_phone_number(fields.to, fields.to_length) ||
+        !message.to.assign(fields.to, fields.to_length)) {
+        return false;
+    }
+    message.body_length = fields.body_length;
+    message.body = fields.body_length > 0 ? arena.store(fields.body, fields.body_length) : nullptr;
+    return true;
+}
+
+// Loads a suppression list (one E.164 number per line, '#' comments allowed)
+// into `suppressed` as PackedPhoneNumber keys. Returns false if the file cannot be read.
+bool load_suppression_list(const std::string& path, std::unordered_set<uint64_t>& suppressed) {
+    std::ifstream infile(path);
+    if (!infile.is_open()) {
+        std::cerr << "ERROR: Unable to open suppression file (" << path << ")." << std::endl;
+        return false;
+    }
+    std::string line;
+    PackedPhoneNumber number;
+    while (std::getline(infile, line)) {
+        line = trim_whitespace(line);
+        if (line.empty() || line[0] == '#') continue;
+        if (is_valid_phone_number(line) && number.assign(line.data(), line.length())) {
+            suppressed.insert(number.key());
+        } else {
+            std::cout << "WARNING: Ignoring invalid number in suppression file: " << line << std::endl;
+        }
+    }
+    return true;
+}
+
+// Totals reported at the end of a batch run.
+struct BatchSummary {
+    long sent = 0;     // Accepted by Twilio (HTTP 201)
+    long failed = 0;   // Rejected by Twilio or failed in transit
+    long invalid = 0;  // Malformed lines or invalid recipients, never sent
+    long skipped = 0;  // Not sent because the circuit breaker was open
+    long suppressed = 0; // Listed in SUPPRESSION_FILE, never sent
+    bool aborted = false; // The batch could not be started; nothing was read or sent
+};
+
+// Posts one body (the whole message, or one numbered part of it) to `message`'s
+// recipient and records the outcome. The response is received into `response`;
+// message->http_code and message->sid are set from it.
+CURLcode send_message_body(CURL *curl, Message& message, const char* body, size_t body_length,
+                           const std::string& encoded_from, std::string& post_data, SmallResponse& response) {
+    int64_t encode_started = trace_clock();
+    post_data.assign("To=%2B");
+    for (size_t i = 0; i < message.to.digit_count; ++i) post_data.push_back(message.to.digit(i));
+    post_data.append("&From=").append(encoded_from).append("&Body=");
+    append_form_encoded(post_data, body, body_length);
+    trace_since("request.encode", encode_started);
+
+    message.http_code = 0;
+    response.clear();
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, post_data.c_str());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(post_data.size()));
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+
+    int64_t request_started = trace_clock();
+    CURLcode res = curl_easy_perform(curl);
+    trace_since("request.http", request_started);
+    TraceSpan response_span("response.handle");
+    if (res == CURLE_OK) {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &message.http_code);
+    }
+    StageTimings timings = read_stage_timings(curl);
+    trace_curl_stages(timings, request_started);
+    char recipient[PackedPhoneNumber::MAX_DIGITS + 2];
+    size_t recipient_length = message.to.write_to(recipient);
+    copy_response_sid(response.data(), response.length(), message.sid, sizeof(message.sid));
+    record_send_result(recipient, recipient_length, response.data(), response.length(),
+                       message.http_code, res, timings, count_sms_segments(body, body_length).segments);
+    if (is_breaker_failure(res, message.http_code)) {
+        g_circuit_breaker.record_failure();
+    } else {
+        g_circuit_breaker.record_success();
+    }
+    return res;
+}
+
+// Sends one chunk of messages on a reused easy handle so the connection to the
+// API stays open between messages. `post_data` and `response` are reused across calls.
+void send_message_chunk(CURL *curl, const std::vector<Message*>& chunk, const std::string& encoded_from,
+                        std::string& post_data, SmallResponse& response, BatchSummary& summary) {
+    std::vector<std::string> parts;
+    for (Message* message : chunk) {
+        if (!g_circuit_breaker.allow_request()) {
+            summary.skipped++;
+            char recipient[PackedPhoneNumber::MAX_DIGITS + 2];
+            size_t recipient_length = message->to.write_to(recipient);
+            record_unsent_result(recipient, recipient_length, RESULT_SKIPPED,
+                                 count_sms_segments(message->body, message->body_length).segments);
+            continue;
+        }
+        CURLcode res;
+        if (message->split) {
+            std::string body(message->body, message->body_length);
+            parts = build_numbered_parts(body, count_sms_segments(body.data(), body.size()).gsm7);
+            res = CURLE_OK;
+            // Parts go out in order; stop at the first failure so recipients never see a gap.
+            for (size_t i = 0; i < parts.size() && res == CURLE_OK && (i == 0 || message->http_code == 201); ++i) {
+                res = send_message_body(curl, *message, parts[i].data(), parts[i].size(), encoded_from, post_data, response);
+            }
+        } else {
+            res = send_message_body(curl, *message, message->body, message->body_length, encoded_from, post_data, response);
+        }
+
+        if (res == CURLE_OK && message->http_code == 201) {
+            summary.sent++;
+        } else {
+            summary.failed++;
+            std::cerr << "ERROR: Line " << message->source_line << " (" << message->to.to_string() << "): ";
+            if (res != CURLE_OK) {
+                std::cerr << curl_easy_strerror(res) << std::endl;
             } else {
-                api_response_str = g_test_ctx.mock_api_response_str;
+                std::cerr << "HTTP " << message->http_code << " " << response.to_string() << std::endl;
             }
-            return false;
+        }
+    }
+}
 
-        case MOCK_URL_ENCODE_FAIL:
-            std::cout << "MOCK_SEND_SMS: Simulating MOCK_URL_ENCODE_FAIL (leads to generic parameter error)." << std::endl;
-             if (g_test_ctx.mock_response_code >= 200 && g_test_ctx.mock_response_code <= 299) {
-                g_test_ctx.mock_response_code = 400; // Typically a bad request
+// Sends every message in a batch file, one "<to_number>,<message body>" per line
+// ('#' starts a comment line). The file is processed BATCH_CHUNK_MESSAGES lines
+// at a time; each chunk's arena and messages are recycled for the next one.
+BatchSummary send_batch_file(const std::string& path, const ConfigData& config) {
+    BatchSummary summary;
+    std::ifstream batch(path);
+    if (!batch.is_open()) {
+        std::cerr << "ERROR: Unable to open batch file (" << path << ")." << std::endl;
+        summary.aborted = true;
+        return summary;
+    }
+    std::unordered_set<uint64_t> suppressed;
+    if (!config.batch.suppression_file.empty() && !load_suppression_list(config.batch.suppression_file, suppressed)) {
+        summary.aborted = true; // Never send a campaign without its suppression list
+        return summary;
+    }
+
+    CURL *curl = HttpRuntime::instance().acquire();
+    if (!curl) {
+        std::cerr << "\nCRITICAL: Failed to initialize libcurl easy handle." << std::endl;
+        summary.aborted = true;
+        return summary;
+    }
+    const std::string url = g_transport_settings.api_base_url + "/2010-04-01/Accounts/" + config.account_sid.c_str() + "/Messages.json";
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_USERNAME, config.account_sid.c_str());
+    curl_easy_setopt(curl, CURLOPT_PASSWORD, config.auth_token.c_str());
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "cpp-sms-app/1.0");
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, SmallResponseWriteCallback);
+    apply_transport_settings(curl, g_transport_settings);
+
+    std::string encoded_from;
+    append_form_encoded(encoded_from, config.from_number.data(), config.from_number.length());
+
+    MessageArena arena;
+    MessagePool pool;
+    std::vector<Message*> chunk;
+    chunk.reserve(BATCH_CHUNK_MESSAGES);
+    SmallResponse response; // Sends are serial, so one response buffer serves the whole batch
+    std::string line, post_data, body_scratch;
+    long line_number = 0;
+    bool more_input = true;
+    while (more_input) {
+        int64_t read_started = trace_clock();
+        while (chunk.size() < BATCH_CHUNK_MESSAGES && (more_input = static_cast<bool>(std::getline(batch, line)))) {
+            line_number++;
+            size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') continue;
+            Message* message = pool.acquire();
+            message->source_line = line_number;
+            if (parse_batch_line(line, *message, arena)) {
+                char recipient[PackedPhoneNumber::MAX_DIGITS + 2];
+                size_t recipient_length = message->to.write_to(recipient);
+                if (suppressed.count(message->to.key()) != 0) {
+                    summary.suppressed++;
+                    record_unsent_result(recipient, recipient_length, RESULT_SUPPRESSED, 0);
+                    pool.release(message);
+                    continue;
+                }
+                body_scratch.assign(message->body ? message->body : "", message->body_length);
+                BodyPreflight preflight = preflight_message_body(body_scratch, config.body);
+                if (preflight.status != BODY_OK) {
+                    summary.invalid++;
+                    record_unsent_result(recipient, recipient_length, RESULT_INVALID, preflight.segments);
+                    std::cerr << "ERROR: Line " << line_number << ": " << describe_body_preflight(preflight, config.body) << "." << std::endl;
+                    pool.release(message);
+                    continue;
+                }
+                if (preflight.stripped > 0) {
+                    message->body = arena.store(body_scratch.data(), body_scratch.size());
+                    message->body_length = body_scratch.size();
+                }
+                message->split = preflight.split;
+                chunk.push_back(message);
+            } else {
+                summary.invalid++;
+                record_unsent_result(line.data() + first, std::min(line.find(',', first), line.size()) - first, RESULT_INVALID, 0);
+                std::cerr << "ERROR: Line " << line_number << ": expected '<E.164 number>,<message>'." << std::endl;
+                pool.release(message);
             }
-            if (g_test_ctx.mock_api_response_str.find("SMmockedsuccessfulsid") != std::string::npos && g_test_ctx.mock_api_response_str.length() < 100) {
-                 api_response_str = "{\"code\": 21601, \"message\": \"Invalid Parameter (simulated URL encode fail)\", \"more_info\": \"https://www.twilio.com/docs/errors/21601\", \"status\": 400}";
+        }
+        trace_since("batch.read_chunk", read_started);
+        send_message_chunk(curl, chunk, encoded_from, post_data, response, summary);
+        for (Message* message : chunk) pool.release(message);
+        chunk.clear();
+        arena.reset();
+        if (line_number > 0) {
+            std::cout << "INFO: Processed " << line_number << " lines (" << summary.sent << " sent, "
+                      << summary.failed << " failed)." << std::endl;
+        }
+    }
+
+    HttpRuntime::instance().release(curl);
+    return summary;
+}
+
+// --- Dry Run ---
+// Counts for one slice of a batch file, or for the whole file once merged.
+struct DryRunTally {
+    long rows = 0;
+    long valid = 0;
+    long invalid = 0;
+    long suppressed = 0;
+    long rejected_bodies = 0; // Counted in invalid: bad UTF-8 or over MAX_SEGMENTS
+    long duplicates = 0;      // Same recipient and body as an earlier valid row
+    long to_send = 0;         // Valid and not suppressed
+    long segments = 0;        // Segments of the rows in to_send
+    long unicode_messages = 0;
+    std::vector<long> country_messages = std::vector<long>(1000, 0); // Indexed by calling code
+    std::vector<long> country_segments = std::vector<long>(1000, 0);
+    // Fingerprints of to_send rows, partitioned by hash into one bucket per worker.
+    std::vector<std::vector<uint64_t>> fingerprints;
+};
+
+// 64-bit FNV-1a hash of recipient key and body, used to detect duplicate rows.
+uint64_t message_fingerprint(uint64_t recipient_key, const char* body, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < 8; ++i) {
+        hash ^= (recipient_key >> (i * 8)) & 0xFF;
+        hash *= 1099511628211ULL;
+    }
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(body[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Analyzes the lines in [begin, end) of a batch file into `tally` without
+// touching the network: validation, suppression, segment counting and
+// per-country totals. Duplicate detection happens after all slices finish.
+void dry_run_slice(const char* begin, const char* end, const std::unordered_set<uint64_t>& suppressed,
+                   const BodySettings& body_settings, size_t buckets, DryRunTally& tally) {
+    TraceSpan span("dry_run.slice");
+    tally.fingerprints.assign(buckets, std::vector<uint64_t>());
+    PackedPhoneNumber number;
+    BatchLineFields fields;
+    std::string scratch;
+    const char* line = begin;
+    while (line < end) {
+        const char* line_end = static_cast<const char*>(memchr(line, '\n', static_cast<size_t>(end - line)));
+        if (!line_end) line_end = end;
+        const char* first = line;
+        while (first < line_end && (*first == ' ' || *first == '\t' || *first == '\r')) first++;
+        if (first < line_end && *first != '#') {
+            tally.rows++;
+            if (split_batch_line(line, line_end, fields) && is_valid_phone_number(fields.to, fields.to_length) &&
+                number.assign(fields.to, fields.to_length)) {
+                uint64_t key = number.key();
+                if (suppressed.count(key) != 0) {
+                    tally.valid++;
+                    tally.suppressed++;
+                    line = line_end + 1;
+                    continue;
+                }
+                // Same checks as a real send; only bodies with control characters need a copy.
+                // `body` is what would be sent, so duplicates are detected after sanitizing.
+                BodyPreflight preflight;
+                const char* body = fields.body;
+                size_t body_length = fields.body_length;
+                Utf8Scan scan = scan_message_body(fields.body, fields.body_length);
+                if (!scan.valid) {
+                    preflight.status = BODY_INVALID_UTF8;
+                } else if (scan.has_control) {
+                    scratch.assign(fields.body, fields.body_length);
+                    preflight = preflight_message_body(scratch, body_settings);
+                    body = scratch.data();
+                    body_length = scratch.size();
+                } else {
+                    check_body_segments(fields.body, fields.body_length, body_settings, preflight);
+                }
+                if (preflight.status != BODY_OK) {
+                    tally.invalid++;
+                    tally.rejected_bodies++;
+                } else {
+                    int code = calling_code_of(fields.to + 1, fields.to_length - 1);
+                    tally.valid++;
+                    tally.to_send++;
+                    tally.segments += static_cast<long>(preflight.segments);
+                    if (!preflight.gsm7) tally.unicode_messages++;
+                    tally.country_messages[static_cast<size_t>(code)]++;
+                    tally.country_segments[static_cast<size_t>(code)] += static_cast<long>(preflight.segments);
+                    uint64_t fingerprint = message_fingerprint(key, body, body_length);
+                    tally.fingerprints[(fingerprint >> 32) % buckets].push_back(fingerprint);
+                }
             } else {
-                api_response_str = g_test_ctx.mock_api_response_str;
+                tally.invalid++;
             }
-            return false;
+        }
+        line = line_end + 1;
+    }
+}
 
-        case MOCK_PERFORM_FAIL:
-            std::cout << "MOCK_SEND_SMS: Simulating MOCK_PERFORM_FAIL (e.g., CURLE_COULDNT_CONNECT)." << std::endl;
-            g_test_ctx.mock_response_code = 0; // No HTTP response in this case
-            api_response_str = ""; // No API response body
-            // The actual error message for curl failure will be printed by the main send_sms function's real path recovery.
-            // Or, we can simulate the specific cerr message here for consistency in test output if needed.
-            // For now, send_sms will print its generic "curl_easy_perform() failed".
-            // Let's ensure the common logging in send_sms reflects this.
-            // This mock only needs to return false and set code to 0.
-            return false;
+// Runs the whole dry-run over a memory-mapped batch file using every core:
+// workers analyze line-aligned slices, then each worker sorts one fingerprint
+// bucket (gathered from all slices) to count duplicates.
+// Returns false if the file or suppression list cannot be read. A non-zero
+// `forced_workers` (tests only) overrides the slice count chosen from the file size.
+bool analyze_batch_file(const std::string& path, const BatchSettings& settings, const BodySettings& body_settings,
+                        DryRunTally& total, size_t& workers_used, size_t forced_workers = 0) {
+    std::unordered_set<uint64_t> suppressed;
+    if (!settings.suppression_file.empty() && !load_suppression_list(settings.suppression_file, suppressed)) {
+        return false;
+    }
 
-        default:
-            std::cout << "MOCK_SEND_SMS: Unknown g_test_ctx.mock_sms_behavior!" << std::endl;
-            g_test_ctx.mock_response_code = 500; // Internal server error
-            api_response_str = "{\"code\": 99999, \"message\": \"Internal Mock Error\"}";
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "ERROR: Unable to open batch file (" << path << ")." << std::endl;
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        std::cerr << "ERROR: Unable to read batch file (" << path << ")." << std::endl;
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(file_stat.st_size);
+    const char* data = nullptr;
+    if (size > 0) {
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            std::cerr << "ERROR: Unable to map batch file (" << path << ")." << std::endl;
+            close(fd);
             return false;
+        }
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapped);
     }
-}
+    close(fd); // The mapping stays valid after the descriptor is closed
 
+    // Small files are not worth the thread start-up cost.
+    size_t workers = std::max<size_t>(1, std::thread::hardware_concurrency());
+    workers = std::min(workers, std::max<size_t>(1, size / (1 << 20)));
+    if (forced_workers > 0) workers = forced_workers;
+    workers_used = workers;
 
-// Validates a phone number string.
-// Basic validation: checks if it's not empty and starts with '+'.
-// For more robust validation, a regex library or more specific checks would be needed.
-// - number: The phone number string to validate.
-// Returns true if the number seems valid, false otherwise.
-bool is_valid_phone_number(const std::string& number) {
-    if (number.empty()) return false;
+    // Cut the file into line-aligned slices of roughly equal size.
+    std::vector<const char*> bounds(1, data);
+    for (size_t i = 1; i < workers; ++i) {
+        const char* cut = data + size * i / workers;
+        const char* newline = static_cast<const char*>(memchr(cut, '\n', static_cast<size_t>(data + size - cut)));
+        bounds.push_back(newline ? newline + 1 : data + size);
+        if (bounds.back() < bounds[bounds.size() - 2]) bounds.back() = bounds[bounds.size() - 2];
+    }
+    bounds.push_back(data + size);
 
-    if (number[0] != '+') return false;
+    std::vector<DryRunTally> tallies(workers);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < workers; ++i) {
+        threads.emplace_back(dry_run_slice, bounds[i], bounds[i + 1], std::cref(suppressed), std::cref(body_settings),
+                             workers, std::ref(tallies[i]));
+    }
+    for (std::thread& t : threads) t.join();
+    threads.clear();
 
-    // Check length: + followed by 7 to 15 digits. So total length 8 to 16.
-    if (number.length() < 8 || number.length() > 16) return false;
+    std::vector<long> bucket_duplicates(workers, 0);
+    for (size_t bucket = 0; bucket < workers; ++bucket) {
+        threads.emplace_back([&tallies, &bucket_duplicates, bucket]() {
+            TraceSpan span("dry_run.dedupe");
+            std::vector<uint64_t> merged;
+            for (DryRunTally& tally : tallies) {
+                merged.insert(merged.end(), tally.fingerprints[bucket].begin(), tally.fingerprints[bucket].end());
+                std::vector<uint64_t>().swap(tally.fingerprints[bucket]);
+            }
+            std::sort(merged.begin(), merged.end());
+            bucket_duplicates[bucket] = static_cast<long>(merged.size()) -
+                static_cast<long>(std::unique(merged.begin(), merged.end()) - merged.begin());
+        });
+    }
+    for (std::thread& t : threads) t.join();
 
-    // Check if all characters after '+' are digits
-    // std::all_of returns true if the predicate returns true for all elements in the range.
-    // Here, it checks characters from the second one (index 1) to the end.
-    return std::all_of(number.begin() + 1, number.end(), ::isdigit);
+    for (size_t i = 0; i < workers; ++i) {
+        const DryRunTally& tally = tallies[i];
+        total.rows += tally.rows;
+        total.valid += tally.valid;
+        total.invalid += tally.invalid;
+        total.suppressed += tally.suppressed;
+        total.rejected_bodies += tally.rejected_bodies;
+        total.to_send += tally.to_send;
+        total.segments += tally.segments;
+        total.unicode_messages += tally.unicode_messages;
+        total.duplicates += bucket_duplicates[i];
+        for (size_t code = 0; code < total.country_messages.size(); ++code) {
+            total.country_messages[code] += tally.country_messages[code];
+            total.country_segments[code] += tally.country_segments[code];
+        }
+    }
+
+    if (data) munmap(const_cast<char*>(data), size);
+    return true;
+}
+
+// Prints the dry-run summary that ops review before approving a campaign.
+void print_dry_run_summary(const std::string& path, const DryRunTally& tally, const BatchSettings& settings,
+                           double elapsed_ms, size_t workers) {
+    std::cout << std::fixed;
+    std::cout << "\n--- Dry Run Summary: " << path << " ---" << std::endl;
+    std::cout << "Rows:             " << tally.rows << std::endl;
+    std::cout << "Valid:            " << tally.valid << std::endl;
+    std::cout << "Invalid:          " << tally.invalid << " (" << tally.rejected_bodies << " with bodies that are not valid UTF-8 or exceed MAX_SEGMENTS)" << std::endl;
+    std::cout << "Suppressed:       " << tally.suppressed << std::endl;
+    std::cout << "Messages to send: " << tally.to_send << " (" << tally.unicode_messages << " need Unicode encoding)" << std::endl;
+    std::cout << "Duplicates:       " << tally.duplicates << " (same recipient and body; included above)" << std::endl;
+    std::cout << "Total segments:   " << tally.segments << std::endl;
+    std::cout << "Estimated cost:   " << std::setprecision(2) << tally.segments * settings.cost_per_segment
+              << " (at " << std::setprecision(4) << settings.cost_per_segment << " per segment)" << std::endl;
+
+    std::cout << "\nPer-country breakdown (by calling code):" << std::endl;
+    std::cout << std::left << std::setw(8) << "Code" << std::right << std::setw(12) << "Messages"
+              << std::setw(12) << "Segments" << std::setw(14) << "Est. cost" << std::endl;
+    for (size_t code = 0; code < tally.country_messages.size(); ++code) {
+        if (tally.country_messages[code] == 0) continue;
+        std::cout << std::left << std::setw(8) << ("+" + std::to_string(code)) << std::right
+                  << std::setw(12) << tally.country_messages[code] << std::setw(12) << tally.country_segments[code]
+                  << std::setw(14) << std::setprecision(2) << tally.country_segments[code] * settings.cost_per_segment << std::endl;
+    }
+    std::cout << "\nINFO: Dry run analyzed " << tally.rows << " rows in " << std::setprecision(1) << elapsed_ms
+              << " ms using " << workers << " thread(s). No messages were sent." << std::endl;
 }
 
 // Main function: Entry point of the application.
 // Prompts the user for Twilio credentials and SMS details, then calls send_sms.
 
-// Test function for config loading and saving
-void run_config_tests() {
+// Sets (or, with nullptr, unsets) an environment variable for the lifetime of
+// the object and restores the previous value afterwards.
+class ScopedEnv {
+public:
+    ScopedEnv(const char* name, const char* value) : name(name) {
+        const char* previous = getenv(name);
+        had_previous = previous != nullptr;
+        if (had_previous) previous_value = previous;
+        if (value) setenv(name, value, 1); else unsetenv(name);
+    }
+    ~ScopedEnv() {
+        if (had_previous) setenv(name, previous_value.c_str(), 1); else unsetenv(name);
+    }
+
+private:
+    ScopedEnv(const ScopedEnv&);
+    ScopedEnv& operator=(const ScopedEnv&);
+    const char* name;
+    std::string previous_value;
+    bool had_previous = false;
+};
+
+// Test function for config loading and saving. Returns the number of failed tests.
+int run_config_tests() {
     const std::string test_config_file = "test_config_delete_me.txt";
     int tests_passed = 0;
     int tests_failed = 0;
+    // Keeps save_config away from a real key and credentials.enc in the working
+    // directory; only T12 opts in, with its own key and store path.
+    ScopedEnv no_env_key("SMS_CREDENTIAL_KEY", nullptr);
+    ScopedEnv no_keyfile("SMS_CREDENTIAL_KEYFILE", "test_credential_delete_me.key");
 
     auto run_test = [&](const std::string& test_name, bool condition) {
         if (condition) {
@@ -443,8 +3678,8 @@ void run_config_tests() {
     std::cout << "\n--- Test Case 1: Save and Load Cycle (Basic) ---" << std::endl;
     std::remove(test_config_file.c_str()); // Clean before test
     ConfigData original_data;
-    original_data.account_sid = "ACtest_sid_123";
-    original_data.auth_token = "test_auth_token_456";
+    original_data.account_sid.assign("ACtest_sid_123");
+    original_data.auth_token.assign("test_auth_token_456");
     original_data.from_number = "+12345678901";
     original_data.loaded_successfully = true;
 
@@ -597,6 +3832,131 @@ void run_config_tests() {
     run_test("T10.3: Auth Token is empty (cleared due to incomplete load)", loaded_no_value_sid.auth_token.empty());
     run_test("T10.4: From Number is empty (cleared due to incomplete load)", loaded_no_value_sid.from_number.empty());
 
+    // Test Case 11: Transport tuning keys are parsed and survive a save/load round trip
+    std::cout << "\n--- Test Case 11: Transport Tuning Keys ---" << std::endl;
+    std::remove(test_config_file.c_str());
+    {
+        std::ofstream tuning_file(test_config_file);
+        tuning_file << "ACCOUNT_SID=ACtuning_sid" << std::endl;
+        tuning_file << "AUTH_TOKEN=tuning_token" << std::endl;
+        tuning_file << "FROM_NUMBER=+12345tuning" << std::endl;
+        tuning_file << "connect_timeout_ms=750" << std::endl;
+        tuning_file << "BREAKER_ERROR_RATE=25" << std::endl;
+        tuning_file << "HEDGE_STATUS_QUERIES=Y" << std::endl;
+        tuning_file << "REQUEST_TIMEOUT_MS=abc" << std::endl; // Invalid, default kept
+        tuning_file << "TRANSPORT_PROFILE=HTTP2" << std::endl;
+        tuning_file << "COST_PER_SEGMENT=0.05" << std::endl;
+        tuning_file << "PREWARM_CONNECTIONS=3" << std::endl;
+        tuning_file << "SUPPRESSION_FILE=optouts.txt" << std::endl;
+        tuning_file << "MAX_SEGMENTS=4" << std::endl;
+        tuning_file << "Split_Long_Messages=yes" << std::endl;
+        tuning_file << "API_BASE_URL=http://127.0.0.1:8080/" << std::endl;
+        tuning_file.close();
+    }
+    ConfigData loaded_tuning = load_config(test_config_file);
+    const TransportSettings default_transport;
+    run_test("T11.1: Load_config successful with tuning keys", loaded_tuning.loaded_successfully);
+    run_test("T11.2: CONNECT_TIMEOUT_MS parsed (case-insensitive key)", loaded_tuning.transport.connect_timeout_ms == 750);
+    run_test("T11.3: BREAKER_ERROR_RATE parsed", loaded_tuning.transport.breaker_error_rate_pct == 25);
+    run_test("T11.4: HEDGE_STATUS_QUERIES parsed", loaded_tuning.transport.hedge_status_queries);
+    run_test("T11.5: Invalid REQUEST_TIMEOUT_MS keeps default", loaded_tuning.transport.request_timeout_ms == default_transport.request_timeout_ms);
+    run_test("T11.6: TRANSPORT_PROFILE parsed and normalized", loaded_tuning.transport.profile == "http2");
+    run_test("T11.7: Batch keys parsed", loaded_tuning.batch.cost_per_segment == 0.05 && loaded_tuning.batch.suppression_file == "optouts.txt");
+    run_test("T11.8: PREWARM_CONNECTIONS parsed", loaded_tuning.transport.prewarm_connections == 3);
+    run_test("T11.9: Body keys parsed", loaded_tuning.body.max_segments == 4 && loaded_tuning.body.split_long_messages);
+    run_test("T11.10: API_BASE_URL parsed without trailing slash", loaded_tuning.transport.api_base_url == "http://127.0.0.1:8080");
+    if (save_config(test_config_file, loaded_tuning)) {
+        ConfigData reloaded_tuning = load_config(test_config_file);
+        run_test("T11.11: Tuning keys survive save/load round trip",
+                 reloaded_tuning.transport.connect_timeout_ms == 750 && reloaded_tuning.transport.hedge_status_queries &&
+                 reloaded_tuning.transport.profile == "http2" && reloaded_tuning.body.max_segments == 4 &&
+                 reloaded_tuning.body.split_long_messages);
+    } else {
+        run_test("T11.11: Tuning keys survive save/load round trip", false);
+    }
+
+    // T12: Encrypted credential store
+    const std::string test_store_file = "test_credentials.enc";
+    std::remove(test_store_file.c_str());
+    SecureBuffer store_key(CREDENTIAL_KEY_BYTES), wrong_key(CREDENTIAL_KEY_BYTES);
+    run_test("T12.1: Hex key parsed", parse_credential_key("00112233445566778899aabbccddeeff00112233445566778899AABBCCDDEEFF", 64, store_key) &&
+             static_cast<unsigned char>(store_key.data()[31]) == 0xFF);
+    run_test("T12.2: Short or non-hex key rejected", !parse_credential_key("0011", 4, wrong_key) &&
+             !parse_credential_key("zz112233445566778899aabbccddeeff00112233445566778899aabbccddeeff", 64, wrong_key));
+    parse_credential_key("ff112233445566778899aabbccddeeff00112233445566778899aabbccddeeff", 64, wrong_key);
+    CredentialStore test_store;
+    std::vector<AccountCredentials> test_accounts;
+    AccountCredentials primary = {"default", "ACstore1", "store_token_one", "+15550000001"};
+    AccountCredentials secondary = {"alerts", "ACstore2", "store_token_two", "+15550000002"};
+    test_accounts.push_back(primary);
+    test_accounts.push_back(secondary);
+    run_test("T12.3: Store saved", test_store.save(test_store_file, store_key, test_accounts));
+    std::ifstream raw_store(test_store_file, std::ios::binary);
+    std::string raw_contents((std::istreambuf_iterator<char>(raw_store)), std::istreambuf_iterator<char>());
+    raw_store.close();
+    run_test("T12.4: Store file does not contain the token", raw_contents.find("store_token_one") == std::string::npos &&
+             raw_contents.compare(0, sizeof(CREDENTIAL_STORE_MAGIC), CREDENTIAL_STORE_MAGIC, sizeof(CREDENTIAL_STORE_MAGIC)) == 0);
+    CredentialStore reloaded_store;
+    bool store_loaded = reloaded_store.load(test_store_file, store_key);
+    const AccountCredentials* found_account = store_loaded ? reloaded_store.snapshot()->find("alerts") : nullptr;
+    run_test("T12.5: Store reloads both accounts", store_loaded && reloaded_store.snapshot()->accounts.size() == 2 &&
+             found_account && std::string(found_account->auth_token) == "store_token_two");
+    run_test("T12.6: Wrong key rejected", !CredentialStore().load(test_store_file, wrong_key));
+    AccountCredentials rotated = {"default", "ACstore1", "store_token_rotated", "+15550000001"};
+    std::shared_ptr<const CredentialSnapshot> before_rotation = reloaded_store.snapshot();
+    bool rotated_ok = reloaded_store.save(test_store_file, store_key, std::vector<AccountCredentials>(1, rotated));
+    run_test("T12.7: Saving replaces one account and keeps the others", rotated_ok &&
+             reloaded_store.snapshot()->accounts.size() == 2 &&
+             std::string(reloaded_store.snapshot()->find("default")->auth_token) == "store_token_rotated" &&
+             std::string(before_rotation->find("default")->auth_token) == "store_token_one"); // Old snapshot stays valid
+    AccountCredentials bad_account = {"bad", "AC\tstore", "token", "+15550000003"};
+    run_test("T12.8: Field with a tab rejected", !reloaded_store.save(test_store_file, store_key, std::vector<AccountCredentials>(1, bad_account)));
+    raw_contents[raw_contents.size() - 1] ^= 0x01; // Flip a tag bit
+    std::ofstream tampered(test_store_file, std::ios::binary);
+    tampered << raw_contents;
+    tampered.close();
+    run_test("T12.9: Modified store rejected", !CredentialStore().load(test_store_file, store_key));
+    std::remove(test_store_file.c_str());
+    {
+        ScopedEnv test_key("SMS_CREDENTIAL_KEY", "00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff");
+        ConfigData store_data;
+        store_data.account_sid.assign("ACstore3");
+        store_data.auth_token.assign("store_token_three");
+        store_data.from_number = "+15550000003";
+        store_data.credentials.store_path = test_store_file;
+        bool store_saved = save_config(test_config_file, store_data);
+        std::ifstream saved_config(test_config_file);
+        std::string saved_contents((std::istreambuf_iterator<char>(saved_config)), std::istreambuf_iterator<char>());
+        saved_config.close();
+        ConfigData store_loaded_data = load_config(test_config_file);
+        run_test("T12.10: Config names the account and the store holds the token", store_saved &&
+                 saved_contents.find("ACCOUNT=default") != std::string::npos &&
+                 saved_contents.find("store_token_three") == std::string::npos &&
+                 store_loaded_data.loaded_successfully && store_loaded_data.auth_token == "store_token_three");
+        run_test("T12.11: Same credentials do not conflict with the stored account", !stored_account_conflicts(store_data));
+        store_data.auth_token.assign("store_token_other");
+        run_test("T12.12: Different credentials conflict with the stored account", stored_account_conflicts(store_data));
+        store_data.credentials.account = "other";
+        run_test("T12.13: A new account name does not conflict", !stored_account_conflicts(store_data));
+        std::remove(test_store_file.c_str());
+    }
+
+    // Test Case 13: Credentials in ConfigData live in shared secure buffers
+    std::cout << "\n--- Test Case 13: Secret Credential Storage ---" << std::endl;
+    {
+        ConfigData secret_data;
+        secret_data.auth_token.assign("secret_token_13");
+        ConfigData secret_copy = secret_data;
+        run_test("T13.1: Copies share one buffer", secret_copy.auth_token.c_str() == secret_data.auth_token.c_str() &&
+                 secret_copy.auth_token == "secret_token_13" && secret_copy.auth_token.size() == 15);
+        secret_data.auth_token.assign("secret_token_rotated");
+        run_test("T13.2: Reassigning leaves earlier copies unchanged",
+                 secret_copy.auth_token == "secret_token_13" && secret_data.auth_token != secret_copy.auth_token);
+        secret_data.auth_token.clear();
+        run_test("T13.3: A cleared secret is empty", secret_data.auth_token.empty() && std::string(secret_data.auth_token.c_str()).empty());
+        run_test("T13.4: A secret can be masked for display", mask_auth_token(secret_copy.auth_token.c_str()) == "sec****_13");
+    }
+
     std::remove(test_config_file.c_str()); // Final cleanup
     std::cout << "\n--- Configuration Tests Finished ---" << std::endl;
     std::cout << "Tests Passed: " << tests_passed << ", Tests Failed: " << tests_failed << std::endl;
@@ -604,6 +3964,462 @@ void run_config_tests() {
         std::cerr << "THERE WERE TEST FAILURES!" << std::endl;
     }
     std::cout << "------------------------------------" << std::endl;
+    return tests_failed;
+}
+
+// Loopback HTTP server for tests that need real transfers. Connection i gets
+// replies[i] after its delay and is then closed; connections past the script
+// get a 500. Requests are not inspected.
+class ScriptedHttpServer {
+public:
+    struct Reply {
+        long delay_ms;
+        int status;
+        std::string body;
+    };
+
+    explicit ScriptedHttpServer(const std::vector<Reply>& replies) : replies(replies) {
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addr_length = sizeof(addr);
+        if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(listen_fd, 16) != 0 || getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &addr_length) != 0) {
+            return;
+        }
+        port = ntohs(addr.sin_port);
+        acceptor = std::thread(&ScriptedHttpServer::serve, this);
+    }
+
+    ~ScriptedHttpServer() {
+        if (listen_fd >= 0) {
+            shutdown(listen_fd, SHUT_RDWR); // Wakes accept()
+            close(listen_fd);
+        }
+        if (acceptor.joinable()) acceptor.join();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    bool valid() const { return port != 0; }
+    std::string base_url() const { return "http://127.0.0.1:" + std::to_string(port); }
+    long connections() const { return accepted.load(); }
+
+private:
+    void serve() {
+        while (true) {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            if (fd < 0) return;
+            size_t index = static_cast<size_t>(accepted++);
+            Reply reply = index < replies.size() ? replies[index] : Reply{0, 500, ""};
+            workers.push_back(std::thread(&ScriptedHttpServer::answer, fd, reply));
+        }
+    }
+
+    static void answer(int fd, Reply reply) {
+        std::string request;
+        char chunk[1024];
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+            if (received <= 0) break;
+            request.append(chunk, static_cast<size_t>(received));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(reply.delay_ms));
+        std::string response = "HTTP/1.1 " + std::to_string(reply.status) + " Scripted\r\nContent-Type: application/json\r\n" +
+                               "Content-Length: " + std::to_string(reply.body.size()) + "\r\nConnection: close\r\n\r\n" + reply.body;
+        send(fd, response.data(), response.size(), MSG_NOSIGNAL); // The client may have abandoned the transfer
+        close(fd);
+    }
+
+    std::vector<Reply> replies;
+    int listen_fd = -1;
+    uint16_t port = 0;
+    std::atomic<long> accepted{0};
+    std::thread acceptor;
+    std::vector<std::thread> workers; // Only touched by the acceptor thread until it is joined
+};
+
+// Test function for the compact batch message representation. Returns the number of failed tests.
+int run_message_tests() {
+    int tests_passed = 0;
+    int tests_failed = 0;
+
+    auto run_test = [&](const std::string& test_name, bool condition) {
+        if (condition) {
+            std::cout << "Test PASSED: " << test_name << std::endl;
+            tests_passed++;
+        } else {
+            std::cerr << "Test FAILED: " << test_name << std::endl;
+            tests_failed++;
+        }
+    };
+
+    std::cout << "\n--- Running Message Representation Tests ---" << std::endl;
+
+    PackedPhoneNumber packed;
+    run_test("M1.1: 15-digit number packs", packed.assign("+123456789012345", 16));
+    run_test("M1.2: Packed number round-trips", packed.to_string() == "+123456789012345");
+    run_test("M1.3: 16-digit number is rejected", !packed.assign("+1234567890123456", 17));
+
+    MessageArena arena(16);
+    const char* first = arena.store("hello", 5);
+    const char* second = arena.store("0123456789abc", 13); // Does not fit in the first block
+    const char* oversized = arena.store("longer than one block", 21);
+    run_test("M2.1: Arena keeps earlier bodies intact", std::string(first, 5) == "hello" && std::string(second, 13) == "0123456789abc");
+    run_test("M2.2: Arena stores oversized bodies", std::string(oversized, 21) == "longer than one block");
+    arena.reset();
+    arena.store("again", 5);
+    run_test("M2.3: Arena reuses blocks after reset", arena.bytes_reserved() == 32);
+
+    std::string encoded;
+    append_form_encoded(encoded, "Hi +1 & =~", 10);
+    run_test("M3.1: Form encoding matches curl_easy_escape", encoded == "Hi%20%2B1%20%26%20%3D~");
+
+    Message message;
+    MessageArena line_arena;
+    run_test("M4.1: Batch line parses", parse_batch_line("+15551234567 ,  Hello, world \r", message, line_arena));
+    run_test("M4.2: Body keeps inner commas and is trimmed", std::string(message.body, message.body_length) == "Hello, world");
+    run_test("M4.3: Invalid recipient is rejected", !parse_batch_line("5551234567,Hello", message, line_arena));
+
+    SmallResponse response;
+    std::string large(SmallResponse::INLINE_CAPACITY, 'x');
+    response.append("ab", 2);
+    response.append(large.data(), large.size());
+    run_test("M5.1: Response spills to heap when inline buffer is full", response.length() == large.size() + 2 && response.to_string().compare(0, 3, "abx") == 0);
+    const std::string sid_json = "{\"sid\": \"SM0123456789abcdef0123456789abcdef\", \"status\": \"queued\"}";
+    copy_response_sid(sid_json.data(), sid_json.size(), message.sid, sizeof(message.sid));
+    run_test("M5.2: Message keeps the parsed SID without a response buffer",
+             std::string(message.sid) == "SM0123456789abcdef0123456789abcdef" && sizeof(Message) < 128);
+
+    std::string gsm_single(160, 'a');
+    std::string gsm_double(161, 'a');
+    std::string ucs2_body = "Caf\xC3\xA9 \xE2\x9C\x93"; // "Café ✓": é is GSM-7, ✓ is not
+    run_test("M6.1: 160 GSM-7 characters fit one segment", count_sms_segments(gsm_single.data(), gsm_single.size()).segments == 1);
+    run_test("M6.2: 161 GSM-7 characters need two segments", count_sms_segments(gsm_double.data(), gsm_double.size()).segments == 2);
+    run_test("M6.3: Extension characters count as two septets", count_sms_segments("{}", 2).units == 4);
+    SegmentInfo ucs2_info = count_sms_segments(ucs2_body.data(), ucs2_body.size());
+    run_test("M6.4: Non-GSM character switches to UCS-2", !ucs2_info.gsm7 && ucs2_info.units == 6);
+    run_test("M7.1: Calling codes resolve to 1, 2 and 3 digits",
+             calling_code_of("15551234567", 11) == 1 && calling_code_of("447700900123", 12) == 44 &&
+             calling_code_of("351912345678", 12) == 351);
+
+    const std::string api_json = "{\"account_sid\": \"ACabc\", \"sid\": \"SM123\", \"error_code\": null, \"code\": 21211}";
+    const char* json_value = nullptr;
+    size_t json_value_length = 0;
+    run_test("M8.1: JSON string value found by exact key",
+             find_json_value(api_json.data(), api_json.size(), "sid", json_value, json_value_length) &&
+             std::string(json_value, json_value_length) == "SM123");
+    run_test("M8.2: JSON null value reported as absent",
+             !find_json_value(api_json.data(), api_json.size(), "error_code", json_value, json_value_length));
+    run_test("M8.3: JSON number value found",
+             find_json_value(api_json.data(), api_json.size(), "code", json_value, json_value_length) &&
+             std::string(json_value, json_value_length) == "21211");
+    const std::string tricky_json = "{\"message\": \"bad \\\"sid\\\": \\\"SMfake\\\"\", "
+                                    "\"subresource_uris\": {\"sid\": \"SMnested\"}, \"sid\": \"SMreal\"}";
+    run_test("M8.4: Key text inside a string value or nested object is not matched",
+             find_json_value(tricky_json.data(), tricky_json.size(), "sid", json_value, json_value_length) &&
+             std::string(json_value, json_value_length) == "SMreal");
+    const std::string escaped_json = "{\"body\": \"say \\\"hi\\\"\", \"status\": 400}";
+    run_test("M8.5: Escaped quotes do not end a string value",
+             find_json_value(escaped_json.data(), escaped_json.size(), "body", json_value, json_value_length) &&
+             std::string(json_value, json_value_length) == "say \\\"hi\\\"" &&
+             find_json_value(escaped_json.data(), escaped_json.size(), "status", json_value, json_value_length) &&
+             std::string(json_value, json_value_length) == "400");
+    const std::string bare_json = "\"sid\": \"SM1\"";
+    run_test("M8.6: Non-object input finds nothing",
+             !find_json_value(bare_json.data(), bare_json.size(), "sid", json_value, json_value_length));
+
+    // M9: UTF-8 scanning and control character stripping
+    std::string long_ascii(40, 'a');
+    run_test("M9.1: Printable ASCII scans clean", scan_message_body(long_ascii.data(), long_ascii.size()).valid &&
+             !scan_message_body(long_ascii.data(), long_ascii.size()).has_control);
+    std::string bad_utf8 = long_ascii + "\xC3\x28 tail";
+    Utf8Scan bad_scan = scan_message_body(bad_utf8.data(), bad_utf8.size());
+    run_test("M9.2: Invalid sequence found after an ASCII run", !bad_scan.valid && bad_scan.error_offset == 40);
+    std::string overlong = "\xC0\xAF";
+    run_test("M9.3: Overlong encoding rejected", !scan_message_body(overlong.data(), overlong.size()).valid);
+    std::string with_controls = long_ascii + "\x01\tline\r\n\x7F\xC2\x85" "end \xE2\x82\xAC";
+    Utf8Scan control_scan = scan_message_body(with_controls.data(), with_controls.size());
+    run_test("M9.4: Controls detected in valid text", control_scan.valid && control_scan.has_control);
+    run_test("M9.5: Controls stripped, tab replaced, newlines kept",
+             strip_control_characters(with_controls) == 4 && with_controls == long_ascii + " line\r\nend \xE2\x82\xAC");
+
+    // M10: Preflight and long-message splitting
+    BodySettings body_settings;
+    std::string words;
+    for (int i = 0; i < 60; ++i) words += "word" + std::to_string(i) + " ";
+    words = trim_whitespace(words);
+    BodyPreflight body_check = preflight_message_body(words, body_settings);
+    run_test("M10.1: Multi-segment body accepted unsplit by default", body_check.status == BODY_OK && !body_check.split &&
+             body_check.segments == count_sms_segments(words.data(), words.size()).segments);
+    body_settings.split_long_messages = true;
+    body_check = preflight_message_body(words, body_settings);
+    std::vector<std::string> body_parts = build_numbered_parts(words, true);
+    bool parts_fit = !body_parts.empty();
+    std::string rejoined;
+    for (size_t i = 0; i < body_parts.size(); ++i) {
+        std::string prefix = "(" + std::to_string(i + 1) + "/" + std::to_string(body_parts.size()) + ") ";
+        parts_fit = parts_fit && count_sms_segments(body_parts[i].data(), body_parts[i].size()).segments == 1 &&
+                    body_parts[i].compare(0, prefix.size(), prefix) == 0;
+        if (!parts_fit) break;
+        rejoined += (i ? " " : "") + body_parts[i].substr(prefix.size());
+    }
+    run_test("M10.2: Split parts are numbered single segments", body_check.split && parts_fit &&
+             body_check.segments == body_parts.size());
+    run_test("M10.3: Split happens on word boundaries", rejoined == words);
+    std::string unicode_body;
+    for (int i = 0; i < 100; ++i) unicode_body += "\xE2\x82\xAC"; // Euro sign forces UCS-2
+    std::vector<std::string> unicode_parts = build_numbered_parts(unicode_body, false);
+    run_test("M10.4: UCS-2 body split into 70-unit parts", unicode_parts.size() == 2 &&
+             count_sms_segments(unicode_parts[0].data(), unicode_parts[0].size()).segments == 1);
+    body_settings.max_segments = 2;
+    run_test("M10.5: Too many parts rejected", preflight_message_body(words, body_settings).status == BODY_TOO_LONG);
+    body_settings.split_long_messages = false;
+    run_test("M10.6: Too many segments rejected", preflight_message_body(words, body_settings).status == BODY_TOO_LONG);
+    std::string invalid_body = "ok \xFF";
+    run_test("M10.7: Invalid UTF-8 body rejected with offset",
+             preflight_message_body(invalid_body, body_settings).status == BODY_INVALID_UTF8 &&
+             preflight_message_body(invalid_body, body_settings).error_offset == 3);
+    std::string spaced_body = "aaaa     bbbb     cccc";
+    std::vector<std::pair<size_t, size_t>> spaced_ranges = split_on_word_boundaries(spaced_body, true, 6);
+    std::string spaced_joined;
+    for (size_t i = 0; i < spaced_ranges.size(); ++i) {
+        spaced_joined += (i ? "|" : "") + spaced_body.substr(spaced_ranges[i].first, spaced_ranges[i].second - spaced_ranges[i].first);
+    }
+    run_test("M10.8: Runs of spaces collapse at breaks without empty parts", spaced_joined == "aaaa|bbbb|cccc");
+
+    // M11: Circuit breaker state transitions, driven with injected timestamps
+    TransportSettings breaker_settings;
+    breaker_settings.breaker_error_rate_pct = 50;
+    breaker_settings.breaker_window = 4;
+    breaker_settings.breaker_min_requests = 4;
+    breaker_settings.breaker_open_ms = 1000;
+    CircuitBreaker breaker;
+    breaker.configure(breaker_settings);
+    const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < 3; ++i) breaker.record_failure(t0);
+    run_test("M11.1: Failures below BREAKER_MIN_REQUESTS keep the breaker closed",
+             breaker.current_state() == CircuitBreaker::CLOSED && breaker.allow_request(t0));
+    breaker.configure(breaker_settings);
+    breaker.record_success();
+    breaker.record_success();
+    breaker.record_success();
+    breaker.record_failure(t0); // 1 of 4 failed
+    bool closed_under_rate = breaker.current_state() == CircuitBreaker::CLOSED;
+    breaker.record_failure(t0); // Oldest success slides out: 2 of 4 failed
+    run_test("M11.2: Breaker trips once failures in the window reach BREAKER_ERROR_RATE",
+             closed_under_rate && breaker.current_state() == CircuitBreaker::OPEN);
+    run_test("M11.3: Open breaker rejects requests until BREAKER_OPEN_MS has passed",
+             !breaker.allow_request(t0 + std::chrono::milliseconds(999)));
+    const std::chrono::steady_clock::time_point t1 = t0 + std::chrono::milliseconds(1000);
+    bool probe_allowed = breaker.allow_request(t1);
+    run_test("M11.4: After the cooldown exactly one half-open probe is allowed",
+             probe_allowed && breaker.current_state() == CircuitBreaker::HALF_OPEN && !breaker.allow_request(t1));
+    breaker.record_failure(t1);
+    run_test("M11.5: Failed probe re-opens the breaker for another cooldown",
+             breaker.current_state() == CircuitBreaker::OPEN && !breaker.allow_request(t1 + std::chrono::milliseconds(999)));
+    const std::chrono::steady_clock::time_point t2 = t1 + std::chrono::milliseconds(1000);
+    bool second_probe = breaker.allow_request(t2);
+    breaker.record_success();
+    run_test("M11.6: Successful probe closes the breaker",
+             second_probe && breaker.current_state() == CircuitBreaker::CLOSED && breaker.allow_request(t2));
+    breaker_settings.breaker_error_rate_pct = 0;
+    breaker.configure(breaker_settings);
+    for (int i = 0; i < 10; ++i) breaker.record_failure(t0);
+    run_test("M11.7: BREAKER_ERROR_RATE=0 disables the breaker",
+             breaker.current_state() == CircuitBreaker::CLOSED && breaker.allow_request(t0));
+
+    // M12: Hedged status queries against a loopback server
+    const TransportSettings saved_transport = g_transport_settings;
+    TransportSettings hedge_settings;
+    hedge_settings.hedge_status_queries = true;
+    hedge_settings.hedge_fallback_delay_ms = 50;
+    std::string status_response;
+    {
+        std::vector<ScriptedHttpServer::Reply> replies;
+        replies.push_back(ScriptedHttpServer::Reply{0, 200, "{\"status\":\"quick\"}"});
+        ScriptedHttpServer server(replies);
+        hedge_settings.api_base_url = server.base_url();
+        configure_transport(hedge_settings);
+        bool ok = server.valid() && fetch_message_status(SecretString("ACtest"), SecretString("token"), "SMtest", status_response);
+        run_test("M12.1: No hedge when the first response beats the hedge delay",
+                 ok && status_response == "{\"status\":\"quick\"}" && server.connections() == 1);
+    }
+    {
+        std::vector<ScriptedHttpServer::Reply> replies;
+        replies.push_back(ScriptedHttpServer::Reply{400, 200, "{\"status\":\"slow\"}"});
+        replies.push_back(ScriptedHttpServer::Reply{0, 200, "{\"status\":\"hedged\"}"});
+        ScriptedHttpServer server(replies);
+        hedge_settings.api_base_url = server.base_url();
+        configure_transport(hedge_settings);
+        bool ok = server.valid() && fetch_message_status(SecretString("ACtest"), SecretString("token"), "SMtest", status_response);
+        run_test("M12.2: Faster 2xx hedge response wins",
+                 ok && status_response == "{\"status\":\"hedged\"}" && server.connections() == 2);
+    }
+    {
+        std::vector<ScriptedHttpServer::Reply> replies;
+        replies.push_back(ScriptedHttpServer::Reply{400, 200, "{\"status\":\"slow\"}"});
+        replies.push_back(ScriptedHttpServer::Reply{0, 503, "{\"status\":\"unavailable\"}"});
+        ScriptedHttpServer server(replies);
+        hedge_settings.api_base_url = server.base_url();
+        configure_transport(hedge_settings);
+        bool ok = server.valid() && fetch_message_status(SecretString("ACtest"), SecretString("token"), "SMtest", status_response);
+        run_test("M12.3: Faster 5xx hedge response does not beat a slower 200",
+                 ok && status_response == "{\"status\":\"slow\"}" && server.connections() == 2);
+    }
+    {
+        std::vector<ScriptedHttpServer::Reply> replies;
+        replies.push_back(ScriptedHttpServer::Reply{0, 503, "{\"status\":\"unavailable\"}"});
+        ScriptedHttpServer server(replies);
+        hedge_settings.api_base_url = server.base_url();
+        configure_transport(hedge_settings);
+        bool ok = server.valid() && fetch_message_status(SecretString("ACtest"), SecretString("token"), "SMtest", status_response);
+        run_test("M12.4: Non-2xx response is reported when nothing succeeds",
+                 server.valid() && !ok && status_response == "{\"status\":\"unavailable\"}");
+    }
+    configure_transport(saved_transport);
+
+    // M13: Dry-run tallies over a small batch file, in one slice and split across several
+    const std::string dry_run_file = "test_dry_run_delete_me.txt";
+    const std::string dry_run_suppression = "test_suppression_delete_me.txt";
+    {
+        std::ofstream batch_out(dry_run_file);
+        batch_out << "# comment\n"
+                  << "+15551234567,Hello\n"
+                  << "+447700900123,Hi there\n"
+                  << "+15551234567,Hello\n"
+                  << "+4477009001234567,Too many digits\n"
+                  << "5551234567,No plus sign\n"
+                  << "+33612345678,Bon\x07jour\n"
+                  << "+15551234567,Hello\n"
+                  << "+33612345678,Bonjour\n"
+                  << "+8613800138000,\xE4\xBD\xA0\xE5\xA5\xBD\n"
+                  << "+15550000000,Opted out\n";
+        std::ofstream suppression_out(dry_run_suppression);
+        suppression_out << "+15550000000\n";
+    }
+    BatchSettings dry_run_settings;
+    dry_run_settings.suppression_file = dry_run_suppression;
+    BodySettings dry_run_body;
+    DryRunTally single_tally, sliced_tally;
+    size_t single_workers = 0, sliced_workers = 0;
+    bool single_ok = analyze_batch_file(dry_run_file, dry_run_settings, dry_run_body, single_tally, single_workers, 1);
+    bool sliced_ok = analyze_batch_file(dry_run_file, dry_run_settings, dry_run_body, sliced_tally, sliced_workers, 4);
+    run_test("M13.1: Rows, invalid and suppressed rows counted",
+             single_ok && single_tally.rows == 10 && single_tally.invalid == 2 && single_tally.valid == 8 &&
+             single_tally.suppressed == 1 && single_tally.to_send == 7);
+    run_test("M13.2: Duplicates counted after control characters are stripped", single_ok && single_tally.duplicates == 3);
+    run_test("M13.3: Per-country and Unicode totals",
+             single_ok && single_tally.country_messages[1] == 3 && single_tally.country_messages[44] == 1 &&
+             single_tally.country_messages[33] == 2 && single_tally.country_messages[86] == 1 &&
+             single_tally.unicode_messages == 1 && single_tally.segments == 7);
+    run_test("M13.4: Slicing the file across workers gives the same tally",
+             sliced_ok && sliced_workers == 4 && sliced_tally.rows == single_tally.rows &&
+             sliced_tally.invalid == single_tally.invalid && sliced_tally.suppressed == single_tally.suppressed &&
+             sliced_tally.to_send == single_tally.to_send && sliced_tally.duplicates == single_tally.duplicates &&
+             sliced_tally.segments == single_tally.segments && sliced_tally.country_messages == single_tally.country_messages);
+    std::remove(dry_run_file.c_str());
+    std::remove(dry_run_suppression.c_str());
+
+    // M14: Result sinks and the asynchronous writer
+    const std::string result_file = "test_results_delete_me.out";
+    std::vector<SendResult> sink_results;
+    sink_results.push_back(make_send_result("+15551234567", 12, RESULT_SENT, 1));
+    std::strcpy(sink_results[0].sid, "SM0123");
+    sink_results[0].http_code = 201;
+    sink_results[0].total_us = 1500;
+    sink_results.push_back(make_send_result("+1,5\"55\n", 8, RESULT_INVALID, 2)); // Malformed batch line text
+    auto read_file = [](const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    };
+    auto split_lines = [](const std::string& text) {
+        std::vector<std::string> lines;
+        std::istringstream in(text);
+        std::string line;
+        while (std::getline(in, line)) lines.push_back(line);
+        return lines;
+    };
+
+    std::remove(result_file.c_str());
+    {
+        CsvResultSink sink(result_file);
+        sink.write(sink_results);
+    }
+    std::vector<std::string> csv_lines = split_lines(read_file(result_file));
+    run_test("M14.1: CSV has the header and one row per result",
+             csv_lines.size() == 3 && csv_lines[0].compare(0, 14, "recipient,sid,") == 0 &&
+             csv_lines[1] == "+15551234567,SM0123,201,0,0,0,0,0,0,0,1500,sent,1," + std::to_string(static_cast<long long>(sink_results[0].timestamp_ms)));
+    run_test("M14.2: CSV row of a malformed recipient keeps the column count",
+             csv_lines.size() == 3 && csv_lines[2].compare(0, 7, "+1555,,") == 0 &&
+             std::count(csv_lines[2].begin(), csv_lines[2].end(), ',') == std::count(csv_lines[0].begin(), csv_lines[0].end(), ','));
+
+    std::remove(result_file.c_str());
+    {
+        NdjsonResultSink sink(result_file);
+        sink.write(sink_results);
+    }
+    std::vector<std::string> ndjson_lines = split_lines(read_file(result_file));
+    bool ndjson_ok = ndjson_lines.size() == 2;
+    const char* field_value = nullptr;
+    size_t field_length = 0;
+    const char* expected_status[] = {"sent", "invalid"};
+    for (size_t i = 0; ndjson_ok && i < ndjson_lines.size(); ++i) {
+        const std::string& row = ndjson_lines[i];
+        ndjson_ok = row.front() == '{' && row.back() == '}' &&
+                    skip_json_value(row.data(), row.data() + row.size()) == row.data() + row.size() &&
+                    find_json_value(row.data(), row.size(), "status", field_value, field_length) &&
+                    std::string(field_value, field_length) == expected_status[i];
+    }
+    run_test("M14.3: NDJSON writes one JSON object per line",
+             ndjson_ok && find_json_value(ndjson_lines[0].data(), ndjson_lines[0].size(), "http_code", field_value, field_length) &&
+             std::string(field_value, field_length) == "201");
+
+    std::remove(result_file.c_str());
+    {
+        ColumnarResultSink sink(result_file);
+        sink.write(sink_results);
+    }
+    std::string columnar = read_file(result_file);
+    auto column_value = [&columnar](size_t offset, size_t width) {
+        uint64_t value = 0;
+        if (offset + width <= columnar.size()) std::memcpy(&value, columnar.data() + offset, width);
+        return value;
+    };
+    // Block layout for 2 rows: count, 10 numeric columns (int64 x1, int32 x3, int64 x6), status, segments, strings
+    const size_t rows_at = 8, timestamps_at = 12, http_at = timestamps_at + 16, total_us_at = http_at + 3 * 8 + 5 * 16;
+    const size_t status_at = total_us_at + 16, segments_at = status_at + 2, recipient_offsets_at = segments_at + 4;
+    const size_t recipient_bytes_at = recipient_offsets_at + 8, sid_offsets_at = recipient_bytes_at + 12 + 5;
+    run_test("M14.4: Columnar file starts with the SMSRCOL2 magic and the row count",
+             columnar.compare(0, 8, "SMSRCOL2") == 0 && column_value(rows_at, 4) == 2);
+    run_test("M14.5: Columnar block lays out each column contiguously",
+             column_value(timestamps_at, 8) == static_cast<uint64_t>(sink_results[0].timestamp_ms) &&
+             column_value(http_at, 4) == 201 && column_value(http_at + 4, 4) == 0 &&
+             column_value(total_us_at, 8) == 1500 &&
+             column_value(status_at, 1) == RESULT_SENT && column_value(status_at + 1, 1) == RESULT_INVALID &&
+             column_value(segments_at, 2) == 1 && column_value(segments_at + 2, 2) == 2 &&
+             column_value(recipient_offsets_at, 4) == 12 && column_value(recipient_offsets_at + 4, 4) == 17 &&
+             columnar.compare(recipient_bytes_at, 17, "+15551234567+1555") == 0 &&
+             column_value(sid_offsets_at, 4) == 6 && column_value(sid_offsets_at + 4, 4) == 6 &&
+             columnar.size() == sid_offsets_at + 8 + 6 && columnar.compare(sid_offsets_at + 8, 6, "SM0123") == 0);
+
+    std::remove(result_file.c_str());
+    {
+        // Flush thresholds the test never reaches: only the destructor writes
+        AsyncResultWriter writer(std::unique_ptr<ResultSink>(new CsvResultSink(result_file)), 1000, std::chrono::milliseconds(60000));
+        for (int i = 0; i < 250; ++i) writer.submit(sink_results[i % 2]);
+    }
+    run_test("M14.6: AsyncResultWriter writes every submitted result when destroyed",
+             split_lines(read_file(result_file)).size() == 251);
+    std::remove(result_file.c_str());
+
+    std::cout << "\n--- Message Representation Tests Finished ---" << std::endl;
+    std::cout << "Tests Passed: " << tests_passed << ", Tests Failed: " << tests_failed << std::endl;
+    if (tests_failed > 0) {
+        std::cerr << "THERE WERE TEST FAILURES!" << std::endl;
+    }
+    std::cout << "------------------------------------" << std::endl;
+    return tests_failed;
 }
 
 // Helper function to process a single line of input, checking for mock directives.
@@ -719,8 +4535,8 @@ static void teardown_test_mode(TestContext& ctx) {
 static void get_user_choice_for_loaded_config(const ConfigData& loaded_config, ConfigData& current_config, TestContext& ctx) {
     if (loaded_config.loaded_successfully) {
         std::cout << "--- Loaded Configuration ---" << std::endl;
-        std::cout << "Account SID: " << loaded_config.account_sid << std::endl;
-        std::cout << "Auth Token:  " << mask_auth_token(loaded_config.auth_token) << std::endl;
+        std::cout << "Account SID: " << loaded_config.account_sid.c_str() << std::endl;
+        std::cout << "Auth Token:  " << mask_auth_token(loaded_config.auth_token.c_str()) << std::endl;
         std::cout << "From Number: " << loaded_config.from_number << std::endl << std::endl;
 
         char use_loaded_choice = 'n';
@@ -766,17 +4582,17 @@ static void collect_credentials_interactively(ConfigData& current_config, const
     while (true) {
         std::cout << "Enter Twilio Account SID";
         if (current_config.loaded_successfully && !current_config.account_sid.empty()) {
-             std::cout << " (loaded: " << current_config.account_sid << ", press Enter to use this): ";
+             std::cout << " (loaded: " << current_config.account_sid.c_str() << ", press Enter to use this): ";
         } else if (!loaded_config.account_sid.empty() && !current_config.loaded_successfully) {
-             std::cout << " (available from " << CONFIG_FILENAME << ": " << loaded_config.account_sid << ", or enter new): ";
+             std::cout << " (available from " << CONFIG_FILENAME << ": " << loaded_config.account_sid.c_str() << ", or enter new): ";
         } else { std::cout << ": "; }
         do { std::getline(*ctx.input_stream, input_sid); if (!ctx.input_stream->good()) {std::cerr << "\nCRITICAL: EOF SID" << std::endl; exit(EXIT_FAILURE);}} while (process_potential_mock_directive(input_sid, ctx) && ctx.input_stream->good());
         input_sid = trim_whitespace(input_sid);
         if (input_sid.empty()) {
             if (current_config.loaded_successfully && !current_config.account_sid.empty()) break;
             if (current_config.account_sid.empty()){ std::cerr << "ERROR: Account SID cannot be empty..." << std::endl; continue;}
-        } else { current_config.account_sid = input_sid; current_config.loaded_successfully = false;}
-        if (!current_config.account_sid.empty() && (current_config.account_sid.rfind("AC", 0) == 0) && current_config.account_sid.length() >= 34) break;
+        } else { current_config.account_sid.assign(input_sid); current_config.loaded_successfully = false;}
+        if (!current_config.account_sid.empty() && (std::strncmp(current_config.account_sid.c_str(), "AC", 2) == 0) && current_config.account_sid.size() >= 34) break;
         std::cerr << "ERROR: Invalid Account SID..." << std::endl;
     }
 
@@ -784,16 +4600,16 @@ static void collect_credentials_interactively(ConfigData& current_config, const
     while (true) {
         std::cout << "Enter Twilio Auth Token";
         if (current_config.loaded_successfully && !current_config.auth_token.empty()) {
-             std::cout << " (loaded: " << mask_auth_token(current_config.auth_token) << ", press Enter to use this): ";
+             std::cout << " (loaded: " << mask_auth_token(current_config.auth_token.c_str()) << ", press Enter to use this): ";
         } else if (!loaded_config.auth_token.empty() && !current_config.loaded_successfully && !current_config.account_sid.empty() && loaded_config.account_sid == current_config.account_sid) {
-             std::cout << " (available from " << CONFIG_FILENAME << "...: " << mask_auth_token(loaded_config.auth_token) << ", or enter new): ";
+             std::cout << " (available from " << CONFIG_FILENAME << "...: " << mask_auth_token(loaded_config.auth_token.c_str()) << ", or enter new): ";
         } else { std::cout << ": ";}
         do { std::getline(*ctx.input_stream, input_token); if (!ctx.input_stream->good()) {std::cerr << "\nCRITICAL: EOF Token" << std::endl; exit(EXIT_FAILURE);}} while (process_potential_mock_directive(input_token, ctx) && ctx.input_stream->good());
         input_token = trim_whitespace(input_token);
         if (input_token.empty()) {
             if (current_config.loaded_successfully && !current_config.auth_token.empty()) break;
             std::cerr << "ERROR: Auth Token cannot be empty..." << std::endl; continue;
-        } else { current_config.auth_token = input_token; current_config.loaded_successfully = false;}
+        } else { current_config.auth_token.assign(input_token); current_config.loaded_successfully = false;}
         if (!current_config.auth_token.empty()) break;
         std::cerr << "ERROR: Auth Token cannot be empty." << std::endl;
     }
@@ -820,9 +4636,12 @@ static void collect_credentials_interactively(ConfigData& current_config, const
             current_config.loaded_successfully = true;
         }
     }
+    wipe_string(input_sid);
+    wipe_string(input_token);
 }
 
-static void collect_sms_details_interactively(std::string& to_number, std::string& message_body, TestContext& ctx) {
+static void collect_sms_details_interactively(std::string& to_number, std::string& message_body,
+                                              const BodySettings& body_settings, BodyPreflight& preflight, TestContext& ctx) {
     std::cout << "\n--- Enter Recipient And Message ---" << std::endl;
     while (true) {
         std::cout << "Enter Recipient's Phone Number (E.164 format, e.g., +1234567890): ";
@@ -831,14 +4650,54 @@ static void collect_sms_details_interactively(std::string& to_number, std::strin
         if (is_valid_phone_number(to_number)) break;
         std::cerr << "ERROR: Invalid recipient phone number format..." << std::endl;
     }
-    std::cout << "Enter Message Body: ";
-    do {std::getline(*ctx.input_stream, message_body); if(!ctx.input_stream->good()){std::cerr << "\nCRITICAL: EOF MsgBody"<<std::endl; exit(EXIT_FAILURE);}} while(process_potential_mock_directive(message_body, ctx) && ctx.input_stream->good());
-    message_body = trim_whitespace(message_body);
+    while (true) {
+        std::cout << "Enter Message Body: ";
+        do {std::getline(*ctx.input_stream, message_body); if(!ctx.input_stream->good()){std::cerr << "\nCRITICAL: EOF MsgBody"<<std::endl; exit(EXIT_FAILURE);}} while(process_potential_mock_directive(message_body, ctx) && ctx.input_stream->good());
+        message_body = trim_whitespace(message_body);
+        preflight = preflight_message_body(message_body, body_settings);
+        if (preflight.status == BODY_INVALID_UTF8) {
+            std::cerr << "ERROR: Message body is not valid UTF-8 (byte " << preflight.error_offset << "). Please re-enter it." << std::endl;
+            continue;
+        }
+        if (preflight.status == BODY_TOO_LONG) {
+            std::cerr << "ERROR: Message body needs " << preflight.segments << (preflight.split ? " parts" : " segments")
+                      << "; the limit is MAX_SEGMENTS=" << body_settings.max_segments << ". Shorten it"
+                      << (preflight.split ? "." : " or set SPLIT_LONG_MESSAGES=Y.") << std::endl;
+            continue;
+        }
+        break;
+    }
+    if (preflight.stripped > 0) {
+        std::cout << "WARNING: Removed " << preflight.stripped << " control character(s) from the message body." << std::endl;
+    }
+    if (preflight.split) {
+        std::cout << "INFO: Message body will be sent as " << preflight.segments << " numbered parts." << std::endl;
+    }
     if (message_body.empty()) {
         std::cout << "WARNING: Message body is empty. An empty SMS will be sent." << std::endl;
     }
 }
 
+// Before credentials replace a stored account that holds different ones, asks
+// whether to overwrite it or save under another account name. Returns false
+// if the user cancels saving.
+static bool confirm_store_account(ConfigData& data, TestContext& ctx) {
+    std::string answer;
+    while (stored_account_conflicts(data)) {
+        std::cout << "Account '" << data.credentials.account << "' in " << data.credentials.store_path
+                  << " holds different credentials. Overwrite it? (Y/N, default N): ";
+        do {std::getline(*ctx.input_stream, answer); if(!ctx.input_stream->good()){std::cerr << "\nCRITICAL: EOF OverwriteChoice"<<std::endl; exit(EXIT_FAILURE);}} while(process_potential_mock_directive(answer, ctx) && ctx.input_stream->good());
+        answer = trim_whitespace(answer);
+        if (!answer.empty() && (answer[0] == 'y' || answer[0] == 'Y')) return true;
+        std::cout << "Enter another account name to save under (blank to cancel): ";
+        do {std::getline(*ctx.input_stream, answer); if(!ctx.input_stream->good()){std::cerr << "\nCRITICAL: EOF AccountName"<<std::endl; exit(EXIT_FAILURE);}} while(process_potential_mock_directive(answer, ctx) && ctx.input_stream->good());
+        answer = trim_whitespace(answer);
+        if (answer.empty()) return false;
+        data.credentials.account = answer;
+    }
+    return true;
+}
+
 static void prompt_and_save_config_if_needed(const ConfigData& current_config, TestContext& ctx) {
     if (current_config.loaded_successfully) {
         char save_choice = 'N';
@@ -850,8 +4709,9 @@ static void prompt_and_save_config_if_needed(const ConfigData& current_config, T
         if (!choice_str_save_cfg.empty() && (choice_str_save_cfg[0] == 'y' || choice_str_save_cfg[0] == 'Y')) {
             save_choice = 'Y';
         }
-        if (save_choice == 'Y') {
-            save_config(CONFIG_FILENAME, current_config);
+        ConfigData to_save = current_config;
+        if (save_choice == 'Y' && confirm_store_account(to_save, ctx)) {
+            save_config(CONFIG_FILENAME, to_save);
         } else {
             std::cout << "\nINFO: Configuration will not be saved." << std::endl;
         }
@@ -860,27 +4720,257 @@ static void prompt_and_save_config_if_needed(const ConfigData& current_config, T
     }
 }
 
+// Handles `--status <MESSAGE_SID>`: looks up a message using the saved configuration.
+static int run_status_query(const std::string& message_sid) {
+    ConfigData config = load_config(CONFIG_FILENAME);
+    if (!config.loaded_successfully) {
+        std::cerr << "ERROR: --status requires a complete " << CONFIG_FILENAME << " (ACCOUNT_SID, AUTH_TOKEN, FROM_NUMBER)." << std::endl;
+        return EXIT_FAILURE;
+    }
+    configure_transport(config.transport);
+    start_http_runtime(config.transport);
+    std::string api_response;
+    return fetch_message_status(config.account_sid, config.auth_token, message_sid, api_response) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Handles `--bench-transport <URL> [REQUESTS] [CONCURRENCY] [--cacert FILE] [--insecure]`.
+// Timeouts from config.txt apply; credentials are not needed.
+static int run_benchmark_command(int argc, char *argv[]) {
+    BenchmarkOptions options;
+    int positional = 0;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--cacert" && i + 1 < argc) {
+            options.ca_file = argv[++i];
+        } else if (arg == "--insecure") {
+            options.insecure = true;
+        } else if (positional == 0 && arg.rfind("--", 0) != 0) {
+            if (!parse_long_setting("REQUESTS", arg, options.requests)) return EXIT_FAILURE;
+            positional++;
+        } else if (positional == 1 && arg.rfind("--", 0) != 0) {
+            if (!parse_long_setting("CONCURRENCY", arg, options.concurrency)) return EXIT_FAILURE;
+            positional++;
+        } else {
+            std::cerr << "ERROR: Unexpected argument '" << arg << "'. Usage: --bench-transport <URL> [REQUESTS] [CONCURRENCY] [--cacert FILE] [--insecure]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (options.requests < 1 || options.concurrency < 1) {
+        std::cerr << "ERROR: REQUESTS and CONCURRENCY must be at least 1." << std::endl;
+        return EXIT_FAILURE;
+    }
+    configure_transport(load_config(CONFIG_FILENAME).transport);
+    run_transport_benchmark(argv[2], options);
+    return EXIT_SUCCESS;
+}
+
+// Handles `--batch <FILE>`: sends every message in FILE using the saved configuration.
+static int run_batch_command(const std::string& batch_path) {
+    ConfigData config = load_config(CONFIG_FILENAME);
+    if (!config.loaded_successfully) {
+        std::cerr << "ERROR: --batch requires a complete " << CONFIG_FILENAME << " (ACCOUNT_SID, AUTH_TOKEN, FROM_NUMBER)." << std::endl;
+        return EXIT_FAILURE;
+    }
+    configure_transport(config.transport);
+    start_http_runtime(config.transport);
+    ResultWriterScope result_writer(config.results);
+    BatchSummary summary = send_batch_file(batch_path, config);
+    if (summary.aborted) {
+        std::cerr << "ERROR: Batch not sent (" << batch_path << ")." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "\n--- Batch Summary ---" << std::endl;
+    std::cout << "Sent:       " << summary.sent << std::endl;
+    std::cout << "Failed:     " << summary.failed << std::endl;
+    std::cout << "Invalid:    " << summary.invalid << std::endl;
+    std::cout << "Skipped:    " << summary.skipped << " (circuit breaker open)" << std::endl;
+    std::cout << "Suppressed: " << summary.suppressed << std::endl;
+    print_startup_metrics();
+    return (summary.failed == 0 && summary.invalid == 0 && summary.skipped == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Handles `--batch <FILE> --dry-run`: previews a batch without sending anything.
+// Credentials are not needed; COST_PER_SEGMENT, SUPPRESSION_FILE and the body keys are used if set.
+static int run_dry_run_command(const std::string& batch_path) {
+    ConfigData config = load_config(CONFIG_FILENAME);
+    const BatchSettings& settings = config.batch;
+    DryRunTally tally;
+    size_t workers = 1;
+    const auto started = std::chrono::steady_clock::now();
+    if (!analyze_batch_file(batch_path, settings, config.body, tally, workers)) {
+        return EXIT_FAILURE;
+    }
+    double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    print_dry_run_summary(batch_path, tally, settings, elapsed_ms, workers);
+    return tally.invalid == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Handles `--accounts`: lists the accounts in the encrypted credential store.
+static int run_accounts_command() {
+    ConfigData config = load_config(CONFIG_FILENAME);
+    std::unique_ptr<SecureBuffer> key = load_credential_key();
+    if (!key) {
+        std::cerr << "ERROR: --accounts requires SMS_CREDENTIAL_KEY or a credential.key keyfile." << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (!g_credential_store.ensure_loaded(config.credentials.store_path, *key)) {
+        return EXIT_FAILURE;
+    }
+    std::shared_ptr<const CredentialSnapshot> snapshot = g_credential_store.snapshot();
+    std::cout << "\n--- Accounts in " << snapshot->path << " ---" << std::endl;
+    for (const AccountCredentials& account : snapshot->accounts) {
+        std::cout << (config.credentials.account == account.name ? "* " : "  ") << std::left << std::setw(20) << account.name
+                  << std::right << " " << account.account_sid << "  " << account.from_number
+                  << "  token " << mask_auth_token(account.auth_token) << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Handles `--import-credentials <FILE>`: adds or replaces the accounts listed
+// in FILE ("<name>,<ACCOUNT_SID>,<AUTH_TOKEN>,<FROM_NUMBER>" per line, '#'
+// comments allowed) in the encrypted store.
+static int run_import_credentials_command(const std::string& import_path) {
+    ConfigData config = load_config(CONFIG_FILENAME);
+    std::unique_ptr<SecureBuffer> key = load_credential_key();
+    if (!key) {
+        std::cerr << "ERROR: --import-credentials requires SMS_CREDENTIAL_KEY or a credential.key keyfile." << std::endl;
+        return EXIT_FAILURE;
+    }
+    // The file is read into locked memory and split in place, so the plaintext
+    // tokens are never copied into ordinary strings.
+    int fd = open(import_path.c_str(), O_RDONLY);
+    struct stat import_stat;
+    if (fd < 0 || fstat(fd, &import_stat) != 0) {
+        if (fd >= 0) close(fd);
+        std::cerr << "ERROR: Unable to open credentials file (" << import_path << ")." << std::endl;
+        return EXIT_FAILURE;
+    }
+    SecureBuffer text(static_cast<size_t>(import_stat.st_size) + 1);
+    size_t length = 0;
+    while (text.valid() && length < text.size() - 1) {
+        ssize_t read_bytes = read(fd, text.data() + length, text.size() - 1 - length);
+        if (read_bytes <= 0) break;
+        length += static_cast<size_t>(read_bytes);
+    }
+    close(fd);
+    if (!text.valid()) {
+        std::cerr << "ERROR: Unable to read credentials file (" << import_path << ")." << std::endl;
+        return EXIT_FAILURE;
+    }
+    text.data()[length] = '\0';
+
+    std::vector<AccountCredentials> accounts;
+    long line_number = 0, invalid = 0;
+    char* line = text.data();
+    char* const text_end = text.data() + length;
+    while (line < text_end) {
+        char* line_end = static_cast<char*>(memchr(line, '\n', text_end - line));
+        if (!line_end) line_end = text_end;
+        char* next_line = line_end < text_end ? line_end + 1 : text_end;
+        line_number++;
+        char* field = line;
+        line = next_line;
+        while (field < line_end && std::isspace(static_cast<unsigned char>(*field))) field++;
+        if (field == line_end || *field == '#') continue;
+        // Splits the line into four comma-separated, trimmed, NUL-terminated fields
+        char* fields[4];
+        size_t field_count = 0;
+        while (field_count < 4 && field <= line_end) {
+            char* field_end = field_count < 3 ? static_cast<char*>(memchr(field, ',', line_end - field)) : line_end;
+            if (!field_end) break;
+            char* first = field;
+            char* last = field_end;
+            while (first < last && std::isspace(static_cast<unsigned char>(*first))) first++;
+            while (last > first && std::isspace(static_cast<unsigned char>(last[-1]))) last--;
+            *last = '\0';
+            fields[field_count++] = first;
+            field = field_end + 1;
+        }
+        if (field_count == 4 && fields[0][0] != '\0' && is_valid_phone_number(fields[3], strlen(fields[3]))) {
+            AccountCredentials account = {fields[0], fields[1], fields[2], fields[3]};
+            accounts.push_back(account);
+        } else {
+            invalid++;
+            std::cerr << "ERROR: Line " << line_number << ": expected '<name>,<ACCOUNT_SID>,<AUTH_TOKEN>,<FROM_NUMBER>'." << std::endl;
+        }
+    }
+    if (invalid > 0 || accounts.empty() || !g_credential_store.save(config.credentials.store_path, *key, accounts)) {
+        std::cerr << "ERROR: No accounts were imported." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "INFO: Imported " << accounts.size() << " account(s) into " << config.credentials.store_path
+              << ". Delete " << import_path << " now that it is no longer needed." << std::endl;
+    return EXIT_SUCCESS;
+}
+
 int main(int argc, char *argv[]) {
+    TraceSession trace_session; // SMS_TRACE_FILE=<path> enables tracing
+    if (argc == 2 && std::string(argv[1]) == "--self-test") {
+        int failures = run_config_tests();
+        failures += run_message_tests();
+        return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (argc == 2 && std::string(argv[1]) == "--accounts") {
+        return run_accounts_command();
+    }
+    if (argc == 3 && std::string(argv[1]) == "--import-credentials") {
+        return run_import_credentials_command(argv[2]);
+    }
+    if (argc == 3 && std::string(argv[1]) == "--status") {
+        return run_status_query(argv[2]);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--bench-transport") {
+        return run_benchmark_command(argc, argv);
+    }
+    if (argc == 3 && std::string(argv[1]) == "--batch") {
+        return run_batch_command(argv[2]);
+    }
+    if (argc == 4 && std::string(argv[1]) == "--batch" && std::string(argv[3]) == "--dry-run") {
+        return run_dry_run_command(argv[2]);
+    }
     if (!setup_test_mode(argc, argv, g_test_ctx)) {
         return EXIT_FAILURE;
     }
 
-    // run_config_tests(); // Keep this commented unless specifically running unit-like tests for config
-
     ConfigData loaded_config = load_config(CONFIG_FILENAME);
     ConfigData current_config;
+    current_config.transport = loaded_config.transport; // Tuning keys apply even if credentials are re-entered
+    current_config.batch = loaded_config.batch;
+    current_config.results = loaded_config.results;
+    current_config.body = loaded_config.body;
+    current_config.credentials = loaded_config.credentials; // Saving updates the same store account
+    ResultWriterScope result_writer(loaded_config.results);
+    configure_transport(loaded_config.transport);
+    if (!g_test_ctx.test_mode) {
+        start_http_runtime(loaded_config.transport); // Pre-warming overlaps with the interactive prompts
+    }
     std::string to_number, message_body, api_response;
+    BodyPreflight preflight;
 
     std::cout << "--- C++ SMS Sender using Twilio ---" << std::endl << std::endl;
 
+    int64_t input_started = trace_clock();
     get_user_choice_for_loaded_config(loaded_config, current_config, g_test_ctx);
     collect_credentials_interactively(current_config, loaded_config, g_test_ctx);
-    collect_sms_details_interactively(to_number, message_body, g_test_ctx);
+    trace_since("input.credentials", input_started);
+    input_started = trace_clock();
+    collect_sms_details_interactively(to_number, message_body, current_config.body, preflight, g_test_ctx);
+    trace_since("input.message", input_started);
     prompt_and_save_config_if_needed(current_config, g_test_ctx);
 
     std::cout << "\n--- Sending SMS ---" << std::endl;
     std::cout << "INFO: Attempting to send SMS via Twilio..." << std::endl;
-    if (send_sms(current_config.account_sid, current_config.auth_token, to_number, current_config.from_number, message_body, api_response)) {
+    std::vector<std::string> parts;
+    if (preflight.split) {
+        parts = build_numbered_parts(message_body, preflight.gsm7);
+    } else {
+        parts.push_back(message_body);
+    }
+    bool all_sent = true;
+    for (size_t i = 0; i < parts.size() && all_sent; ++i) {
+        all_sent = send_sms(current_config.account_sid, current_config.auth_token, to_number, current_config.from_number, parts[i], api_response);
+    }
+    if (all_sent) {
         // Messages handled by send_sms
     } else {
         // Error messages handled by send_sms or sub-functions
@@ -888,6 +4978,9 @@ int main(int argc, char *argv[]) {
         // std::cerr << "ERROR: Overall message sending process failed. Check previous messages for details." << std::endl;
     }
 
+    if (!g_test_ctx.test_mode) {
+        print_startup_metrics();
+    }
     teardown_test_mode(g_test_ctx);
    return 0;
 